@@ -0,0 +1,203 @@
+// Scaling benchmark of the graph pipeline. For every topology of
+// generateGraph() and every size it builds a random graph and times each
+// GraphObj phase once on it, in the order a model goes through them. The
+// exponent column is the slope of log(time) over log(#ops) from the
+// previous size: about 1 for a linear phase, 2 for a quadratic one. Once
+// the graph outgrows the caches, memory latency alone adds a few tenths.
+// Results can be written as JSON and compared between commits with
+// bench/compare.py.
+//
+//   bench_graph [--topology NAME] [--sizes N,N,...] [--repeat N]
+//               [--max-exponent X] [--json PATH]
+
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "utils/graph_generator.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+
+using namespace infini;
+
+namespace {
+
+const GraphTopology allTopologies[] = {
+    GraphTopology::Chain, GraphTopology::FanOut,
+    GraphTopology::TransposeHeavy, GraphTopology::ConcatHeavy,
+    GraphTopology::Mixed};
+
+struct Phase {
+    const char *name;
+    std::function<void(Graph)> run;
+};
+
+const vector<Phase> &allPhases() {
+    static const vector<Phase> phases{
+        {"topo_sort", [](Graph g) { IT_ASSERT(g->topo_sort()); }},
+        {"checkValid", [](Graph g) { g->checkValid(); }},
+        {"shape_infer", [](Graph g) { g->shape_infer(); }},
+        {"optimize", [](Graph g) { g->optimize(); }},
+        {"dataMalloc", [](Graph g) { g->dataMalloc(); }},
+        {"compile", [](Graph g) { g->compile(); }},
+    };
+    return phases;
+}
+
+struct Result {
+    string name;
+    size_t ops;
+    double seconds; // median over the repeats
+    double exponent;
+};
+
+double median(vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+// The time of "build" followed by each phase, the median of "repeat" runs
+// on fresh graphs. The first entry is the build.
+vector<double> timePipeline(const GraphGeneratorConfig &config, int repeat,
+                            size_t &ops) {
+    using Clock = std::chrono::steady_clock;
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto &phases = allPhases();
+    vector<vector<double>> samples(phases.size() + 1);
+    for (int r = 0; r < repeat; ++r) {
+        auto start = Clock::now();
+        Graph g = generateGraph(runtime, config);
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        samples[0].emplace_back(elapsed.count());
+        ops = g->getOperators().size();
+        // keep the allocator's report out of the table
+        std::ostringstream quiet;
+        auto saved = std::cout.rdbuf(quiet.rdbuf());
+        for (size_t i = 0; i < phases.size(); ++i) {
+            start = Clock::now();
+            phases[i].run(g);
+            elapsed = Clock::now() - start;
+            samples[i + 1].emplace_back(elapsed.count());
+        }
+        std::cout.rdbuf(saved);
+    }
+    vector<double> ret;
+    for (auto &s : samples)
+        ret.emplace_back(median(s));
+    return ret;
+}
+
+void writeJson(const string &path, const vector<Result> &results) {
+    std::ofstream file(path);
+    IT_ASSERT(file.good(), "Cannot open " + path);
+    file << std::setprecision(6);
+    file << "{\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &r = results[i];
+        file << (i ? ",\n" : "\n") << "    {\"name\": " << jsonQuote(r.name)
+             << ", \"ops\": " << r.ops
+             << ", \"median_us\": " << r.seconds * 1e6 << ", \"exponent\": ";
+        if (std::isnan(r.exponent))
+            file << "null";
+        else
+            file << r.exponent;
+        file << "}";
+    }
+    file << "\n  ]\n}\n";
+}
+
+vector<size_t> parseSizes(const string &list) {
+    vector<size_t> sizes;
+    std::istringstream iss(list);
+    string item;
+    while (std::getline(iss, item, ','))
+        sizes.emplace_back(std::stoul(item));
+    return sizes;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    string topologyName, jsonPath;
+    vector<size_t> sizes{1000, 10000, 100000};
+    int repeat = 1;
+    double maxExponent = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--topology" && i + 1 < argc)
+            topologyName = argv[++i];
+        else if (arg == "--sizes" && i + 1 < argc)
+            sizes = parseSizes(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--max-exponent" && i + 1 < argc)
+            maxExponent = std::stod(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--topology NAME] [--sizes N,N,...] [--repeat N]"
+                         " [--max-exponent X] [--json PATH]\n";
+            return 1;
+        }
+    }
+
+    std::cout << std::left << std::setw(40) << "Case" << std::right
+              << std::setw(9) << "#ops" << std::setw(12) << "time(ms)"
+              << std::setw(10) << "ns/op" << std::setw(10) << "exponent"
+              << "\n";
+    vector<Result> results;
+    int superLinear = 0;
+    for (auto topology : allTopologies) {
+        string name = graphTopologyToString(topology);
+        if (!topologyName.empty() && topologyName != name)
+            continue;
+        vector<double> previous;
+        size_t previousOps = 0;
+        for (auto size : sizes) {
+            GraphGeneratorConfig config;
+            config.topology = topology;
+            config.numOps = size;
+            size_t ops = 0;
+            auto times = timePipeline(config, repeat, ops);
+            for (size_t i = 0; i < times.size(); ++i) {
+                Result r;
+                r.name = name + "/" + std::to_string(size) + "/" +
+                         (i ? allPhases()[i - 1].name : "build");
+                r.ops = ops;
+                r.seconds = times[i];
+                r.exponent = NAN;
+                if (!previous.empty() && previous[i] > 0)
+                    r.exponent = std::log(times[i] / previous[i]) /
+                                 std::log(double(ops) / previousOps);
+                std::cout << std::left << std::setw(40) << r.name
+                          << std::right << std::setw(9) << r.ops
+                          << std::fixed << std::setprecision(3)
+                          << std::setw(12) << r.seconds * 1e3
+                          << std::setprecision(1) << std::setw(10)
+                          << r.seconds / ops * 1e9 << std::setprecision(2)
+                          << std::setw(10);
+                if (std::isnan(r.exponent))
+                    std::cout << "-";
+                else
+                    std::cout << r.exponent;
+                // phases under a millisecond are too noisy to judge
+                bool flagged = maxExponent > 0 && r.exponent > maxExponent &&
+                               r.seconds > 1e-3;
+                std::cout << (flagged ? "  super-linear" : "") << std::endl;
+                superLinear += flagged;
+                results.emplace_back(std::move(r));
+            }
+            previous = times;
+            previousOps = ops;
+        }
+    }
+    if (!jsonPath.empty())
+        writeJson(jsonPath, results);
+    if (superLinear)
+        std::cout << superLinear << " phase(s) scale worse than #ops^"
+                  << maxExponent << "\n";
+    return superLinear ? 2 : 0;
+}
@@ -0,0 +1,360 @@
+// Micro-benchmarks of every CPU kernel. Each case builds a one-operator
+// graph, times its compiled kernel until enough samples are collected and
+// reports the median and p99 time with the throughput derived from
+// OperatorObj::getCost(). Results can be written as JSON and compared
+// between commits with bench/compare.py.
+//
+//   bench_kernels [--filter SUBSTRING] [--min-time SECONDS] [--json PATH]
+
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/fused_element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/cpu_features.h"
+#include "utils/half.h"
+#include "utils/thread_pool.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+using namespace infini;
+
+namespace {
+
+struct Case {
+    string name;
+    // Adds the inputs and the operator under test to an empty graph.
+    std::function<void(Graph)> build;
+};
+
+struct Result {
+    string name, kernel;
+    size_t samples;
+    double median, p99; // seconds
+    double gflops, gbps;
+};
+
+const char *dtypeName(DataType dtype) {
+    if (dtype == DataType::Float32)
+        return "f32";
+    if (dtype == DataType::Float16)
+        return "f16";
+    if (dtype == DataType::BFloat16)
+        return "bf16";
+    if (dtype == DataType::UInt32)
+        return "u32";
+    return "other";
+}
+
+string shapeName(const Shape &shape) { return vecToString(shape); }
+
+// Values in [-1, 1] for floating point types and small positive integers
+// otherwise, so that no kernel runs into overflow, NaN, denormals or an
+// integer division by zero.
+void fill(const Tensor &tensor, std::mt19937 &rng) {
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    auto dtype = tensor->getDType();
+    size_t n = tensor->size();
+    auto ptr = tensor->getRawDataPtr<void *>();
+    if (dtype == DataType::Float32) {
+        for (size_t i = 0; i < n; ++i)
+            static_cast<float *>(ptr)[i] = dist(rng);
+    } else if (dtype == DataType::Float16) {
+        for (size_t i = 0; i < n; ++i)
+            static_cast<fp16_t *>(ptr)[i] = floatToFp16(dist(rng));
+    } else if (dtype == DataType::BFloat16) {
+        for (size_t i = 0; i < n; ++i)
+            static_cast<bf16_t *>(ptr)[i] = floatToBf16(dist(rng));
+    } else {
+        // little-endian integers of any width, from 1 to 8
+        std::memset(ptr, 0, tensor->getBytes());
+        auto bytes = static_cast<uint8_t *>(ptr);
+        size_t elemSize = dtype.getSize();
+        for (size_t i = 0; i < n; ++i)
+            bytes[i * elemSize] = 1 + rng() % 8;
+    }
+}
+
+Result runCase(const Case &c, double minTime) {
+    using Clock = std::chrono::steady_clock;
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    c.build(g);
+    // keep the allocator's report out of the table
+    std::ostringstream quiet;
+    auto saved = std::cout.rdbuf(quiet.rdbuf());
+    g->dataMalloc();
+    std::cout.rdbuf(saved);
+    std::mt19937 rng(42);
+    for (auto &tensor : g->getInputs())
+        fill(tensor, rng);
+    g->compile();
+    IT_ASSERT(g->getPlan().size() == 1);
+    auto &instr = g->getPlan()[0];
+
+    // warm caches, page in the arena and start the pool threads
+    auto warmEnd = Clock::now() + std::chrono::duration<double>(minTime / 10);
+    for (int i = 0; i < 3 || Clock::now() < warmEnd; ++i)
+        instr.func();
+
+    vector<double> samples;
+    double total = 0;
+    while ((total < minTime || samples.size() < 10) &&
+           samples.size() < 100000) {
+        auto start = Clock::now();
+        instr.func();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        samples.emplace_back(elapsed.count());
+        total += elapsed.count();
+    }
+    std::sort(samples.begin(), samples.end());
+    Result r;
+    r.name = c.name;
+    r.kernel = std::get<1>(KernelRegistry::getInstance().getKernelItem(
+        KernelAttrs{runtime->getDevice(),
+                    instr.op->getOpType().underlying()}));
+    r.samples = samples.size();
+    r.median = samples[samples.size() / 2];
+    r.p99 = samples[size_t(std::ceil(samples.size() * 0.99)) - 1];
+    auto cost = instr.op->getCost();
+    r.gflops = cost.flops / r.median * 1e-9;
+    r.gbps = cost.bytes / r.median * 1e-9;
+    return r;
+}
+
+vector<Case> allCases() {
+    vector<Case> cases;
+    const vector<DataType> floatTypes{DataType::Float32, DataType::Float16,
+                                      DataType::BFloat16};
+
+    // Element-wise: every operator on one pattern, then every broadcasting
+    // pattern with Add.
+    using BinaryBuilder = std::function<void(Graph, Tensor, Tensor)>;
+    const vector<std::pair<string, BinaryBuilder>> binaries{
+        {"Add",
+         [](Graph g, Tensor a, Tensor b) { g->addOp<AddObj>(a, b, nullptr); }},
+        {"Sub",
+         [](Graph g, Tensor a, Tensor b) { g->addOp<SubObj>(a, b, nullptr); }},
+        {"Mul",
+         [](Graph g, Tensor a, Tensor b) { g->addOp<MulObj>(a, b, nullptr); }},
+        {"Div",
+         [](Graph g, Tensor a, Tensor b) { g->addOp<DivObj>(a, b, nullptr); }},
+    };
+    const vector<std::pair<Shape, Shape>> patterns{
+        {{1024, 1024}, {1024, 1024}}, // same shape
+        {{1024, 1024}, {1}},          // scalar
+        {{1024, 1024}, {1024}},       // row vector
+        {{1024, 1024}, {1024, 1}},    // column vector
+        {{1024, 1}, {1, 1024}},       // outer product
+        {{16, 64, 1024}, {64, 1}},    // middle dimension
+    };
+    for (auto &[opName, build] : binaries) {
+        for (auto dtype : {DataType::Float32, DataType::Float16,
+                           DataType::BFloat16, DataType::UInt32}) {
+            for (size_t p = 0; p < patterns.size(); ++p) {
+                // only Add sweeps the broadcasting patterns
+                if (p > 0 && opName != "Add")
+                    break;
+                auto [sa, sb] = patterns[p];
+                cases.push_back(
+                    {opName + "/" + dtypeName(dtype) + "/" + shapeName(sa) +
+                         "+" + shapeName(sb),
+                     [=](Graph g) {
+                         build(g, g->addTensor(sa, dtype),
+                               g->addTensor(sb, dtype));
+                     }});
+            }
+        }
+    }
+
+    // Unary and Clip.
+    for (auto dtype : floatTypes) {
+        Shape shape{1024, 1024};
+        cases.push_back({string("Relu/") + dtypeName(dtype) + "/" +
+                             shapeName(shape),
+                         [=](Graph g) {
+                             g->addOp<ReluObj>(g->addTensor(shape, dtype),
+                                               nullptr);
+                         }});
+        cases.push_back({string("Clip/") + dtypeName(dtype) + "/" +
+                             shapeName(shape),
+                         [=](Graph g) {
+                             g->addOp<ClipObj>(g->addTensor(shape, dtype),
+                                               nullptr, -0.5f, 0.5f);
+                         }});
+    }
+
+    // Transpose permutations, from a plain 2D transpose to ones that keep
+    // the last dimension.
+    const vector<std::pair<Shape, Shape>> perms{
+        {{2048, 2048}, {1, 0}},
+        {{64, 128, 256}, {0, 2, 1}},
+        {{64, 128, 256}, {2, 1, 0}},
+        {{64, 128, 256}, {1, 0, 2}},
+        {{8, 64, 32, 64}, {0, 2, 1, 3}},
+    };
+    for (auto dtype : {DataType::Float32, DataType::Float16}) {
+        for (auto &[shape, perm] : perms) {
+            cases.push_back({string("Transpose/") + dtypeName(dtype) + "/" +
+                                 shapeName(shape) + "/perm" + shapeName(perm),
+                             [=](Graph g) {
+                                 g->addOp<TransposeObj>(
+                                     g->addTensor(shape, dtype), nullptr, perm);
+                             }});
+        }
+    }
+
+    // Concat of three inputs along every axis.
+    for (int axis = 0; axis < 3; ++axis) {
+        Shape shape{32, 64, 128};
+        cases.push_back(
+            {"Concat/f32/3x" + shapeName(shape) + "/axis" +
+                 std::to_string(axis),
+             [=](Graph g) {
+                 TensorVec inputs;
+                 for (int i = 0; i < 3; ++i)
+                     inputs.emplace_back(
+                         g->addTensor(shape, DataType::Float32));
+                 g->addOp<ConcatObj>(inputs, nullptr, axis);
+             }});
+    }
+
+    // MatMul: square sizes around the cache blocking, a matrix-vector
+    // product, a skinny batch and transposed operands.
+    struct Gemm {
+        Shape a, b;
+        bool transA, transB;
+    };
+    const vector<Gemm> gemms{
+        {{64, 64}, {64, 64}, false, false},
+        {{256, 256}, {256, 256}, false, false},
+        {{512, 512}, {512, 512}, false, false},
+        {{1, 1024}, {1024, 4096}, false, false},
+        {{8, 128, 256}, {256, 256}, false, false},
+        {{512, 512}, {512, 512}, true, false},
+        {{512, 512}, {512, 512}, false, true},
+    };
+    for (auto dtype : floatTypes) {
+        for (auto &gemm : gemms) {
+            string name = string("MatMul/") + dtypeName(dtype) + "/" +
+                          shapeName(gemm.a) + (gemm.transA ? "T" : "") + "x" +
+                          shapeName(gemm.b) + (gemm.transB ? "T" : "");
+            cases.push_back({name, [=](Graph g) {
+                                 g->addOp<MatmulObj>(
+                                     g->addTensor(gemm.a, dtype),
+                                     g->addTensor(gemm.b, dtype), nullptr,
+                                     gemm.transA, gemm.transB);
+                             }});
+        }
+    }
+
+    // Cast pairs that models use.
+    const vector<std::tuple<string, CastType, DataType>> casts{
+        {"Float2Float16", CastType::Float2Float16, DataType::Float32},
+        {"Float162Float", CastType::Float162Float, DataType::Float16},
+        {"Float2BFloat16", CastType::Float2BFloat16, DataType::Float32},
+        {"BFloat162Float", CastType::BFloat162Float, DataType::BFloat16},
+        {"Float2Int32", CastType::Float2Int32, DataType::Float32},
+        {"Int322Float", CastType::Int322Float, DataType::Int32},
+        {"Int642Int32", CastType::Int642Int32, DataType::Int64},
+        {"Uint82Float", CastType::Uint82Float, DataType::UInt8},
+    };
+    for (auto &[castName, castType, from] : casts) {
+        Shape shape{1024, 1024};
+        cases.push_back({"Cast/" + castName + "/" + shapeName(shape),
+                         [=, castType = castType, from = from](Graph g) {
+                             g->addOp<CastObj>(g->addTensor(shape, from),
+                                               nullptr, castType);
+                         }});
+    }
+
+    // FusedElementWise: relu(a * b + c) in one pass.
+    for (auto dtype : {DataType::Float32, DataType::Float16}) {
+        Shape shape{1024, 1024};
+        cases.push_back(
+            {string("FusedElementWise/") + dtypeName(dtype) +
+                 "/relu(a*b+c)/" + shapeName(shape),
+             [=](Graph g) {
+                 TensorVec inputs{g->addTensor(shape, dtype),
+                                  g->addTensor(shape, dtype),
+                                  g->addTensor({1024}, dtype)};
+                 vector<FusedStep> steps{
+                     {OpType::Mul, 0, 1, 0, 0, dtype},
+                     {OpType::Add, 3, 2, 0, 0, dtype},
+                     {OpType::Relu, 4, -1, 0, 0, dtype},
+                 };
+                 g->addOp<FusedElementWiseObj>(inputs, nullptr, steps);
+             }});
+    }
+    return cases;
+}
+
+void writeJson(const string &path, const vector<Result> &results) {
+    std::ofstream file(path);
+    IT_ASSERT(file.good(), "Cannot open " + path);
+    file << std::setprecision(6);
+    file << "{\n  \"isa\": " << jsonQuote(cpuIsaToString(getCpuIsa()))
+         << ",\n  \"threads\": " << ThreadPool::getInstance().size()
+         << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &r = results[i];
+        file << (i ? ",\n" : "\n") << "    {\"name\": " << jsonQuote(r.name)
+             << ", \"kernel\": " << jsonQuote(r.kernel)
+             << ", \"samples\": " << r.samples
+             << ", \"median_us\": " << r.median * 1e6
+             << ", \"p99_us\": " << r.p99 * 1e6 << ", \"gflops\": " << r.gflops
+             << ", \"gbps\": " << r.gbps << "}";
+    }
+    file << "\n  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    string filter, jsonPath;
+    double minTime = 0.2;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc)
+            filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc)
+            minTime = std::stod(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--filter SUBSTRING] [--min-time SECONDS]"
+                         " [--json PATH]\n";
+            return 1;
+        }
+    }
+
+    std::cout << "ISA " << cpuIsaToString(getCpuIsa()) << ", "
+              << ThreadPool::getInstance().size() << " threads\n";
+    std::cout << std::left << std::setw(56) << "Case" << std::right
+              << std::setw(12) << "median(us)" << std::setw(12) << "p99(us)"
+              << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s"
+              << "\n";
+    vector<Result> results;
+    for (auto &c : allCases()) {
+        if (c.name.find(filter) == string::npos)
+            continue;
+        auto r = runCase(c, minTime);
+        std::cout << std::left << std::setw(56) << r.name << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(12)
+                  << r.median * 1e6 << std::setw(12) << r.p99 * 1e6
+                  << std::setw(10) << r.gflops << std::setw(10) << r.gbps
+                  << std::endl;
+        results.emplace_back(std::move(r));
+    }
+    if (!jsonPath.empty())
+        writeJson(jsonPath, results);
+    return 0;
+}
@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+"""Compare two bench_kernels or bench_graph JSON files, e.g. of a base and a new commit.
+
+    python3 bench/compare.py base.json new.json [--threshold 0.1]
+
+Prints the median time of every case found in both files and the ratio
+new / base. Exits with status 1 if a case got slower than 1 + threshold.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {r["name"]: r for r in json.load(f)["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=0.1,
+                        help="relative slowdown reported as a regression")
+    args = parser.parse_args()
+
+    base, new = load(args.base), load(args.new)
+    regressions = 0
+    print(f"{'Case':56}{'base(us)':>12}{'new(us)':>12}{'ratio':>8}")
+    for name in new:
+        if name not in base:
+            continue
+        old_us, new_us = base[name]["median_us"], new[name]["median_us"]
+        ratio = new_us / old_us if old_us > 0 else float("inf")
+        mark = ""
+        if ratio > 1 + args.threshold:
+            mark = "  slower"
+            regressions += 1
+        elif ratio < 1 / (1 + args.threshold):
+            mark = "  faster"
+        print(f"{name:56}{old_us:12.2f}{new_us:12.2f}{ratio:8.3f}{mark}")
+    for name in sorted(base.keys() - new.keys()):
+        print(f"{name:56} missing in {args.new}")
+    print(f"{regressions} regression(s) above {args.threshold:.0%}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -6,6 +6,7 @@
 #endif
 #include <cstddef>
 #include <map>
+#include <set>
 #include <unordered_set>
 
 namespace infini {
@@ -14,6 +15,7 @@ namespace infini {
   private:
     Runtime runtime;
 
+    // end offset of the region in use; every free block lies below it
     size_t used;
 
     size_t peak;
@@ -28,6 +30,10 @@ namespace infini {
     // HINT: 可以使用一个 map 来存储 free block，key 为 block 的起始/结尾地址，value 为 block 的大小
     // =================================== 作业 ===================================
     std::map<size_t, size_t> free_blocks;
+
+    // the same free blocks as (size, offset) pairs, ordered for best-fit
+    // lookup in O(log n); always kept in sync with free_blocks
+    std::set<std::pair<size_t, size_t>> free_by_size;
   public:
     Allocator(Runtime runtime);
 
@@ -55,5 +61,11 @@ namespace infini {
     // function: memory alignment, rouned up
     // return: size of the aligned memory block
     size_t getAlignedSize(size_t size);
+
+    // function: add a free block to both indexes
+    void insertFreeBlock(size_t addr, size_t size);
+
+    // function: remove a free block from both indexes
+    void eraseFreeBlock(std::map<size_t, size_t>::iterator it);
   };
 }
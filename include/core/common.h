@@ -82,4 +82,25 @@ template <typename T> std::string vecToString(const T *st, size_t length) {
     return ss.str();
 }
 
+// A string as a JSON string literal: quoted, with '"', '\\' and the control
+// characters escaped.
+inline std::string jsonQuote(const std::string &s) {
+    static const char hex[] = "0123456789abcdef";
+    std::string ret = "\"";
+    for (char c : s) {
+        auto u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+            ret += c;
+        } else if (u < 0x20) {
+            ret += "\\u00";
+            ret += hex[u >> 4];
+            ret += hex[u & 15];
+        } else {
+            ret += c;
+        }
+    }
+    return ret + "\"";
+}
+
 } // namespace infini
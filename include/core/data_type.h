@@ -1,5 +1,6 @@
 #pragma once
 #include "core/common.h"
+#include "utils/half.h"
 #include <cstdint>
 
 namespace infini {
@@ -23,7 +24,7 @@ class DataType {
     static const DataType UInt64;
     static const DataType BFloat16;
     // "sizePerElement" show the DType to cpu_type
-    // DataType::Bool -> int8_t   DataType::Float16 -> uint16_t
+    // DataType::Bool -> int8_t   DataType::Float16 -> fp16_t
     static constexpr size_t sizePerElement[]{0,
                                              sizeof(float),
                                              sizeof(uint8_t),
@@ -95,10 +96,10 @@ template <> struct DT<6> { using t = int32_t; };
 template <> struct DT<7> { using t = int64_t; };
 template <> struct DT<8> { using t = char; };
 template <> struct DT<9> { using t = int8_t; };
-template <> struct DT<10> { using t = uint16_t; };
+template <> struct DT<10> { using t = fp16_t; };
 template <> struct DT<11> { using t = double; };
 template <> struct DT<12> { using t = uint32_t; };
 template <> struct DT<13> { using t = uint64_t; };
-template <> struct DT<16> { using t = uint16_t; };
+template <> struct DT<16> { using t = bf16_t; };
 
 } // namespace infini
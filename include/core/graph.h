@@ -1,6 +1,8 @@
 #pragma once
 #include "core/allocator.h"
+#include "core/kernel.h"
 #include "core/operator.h"
+#include "core/rewrite.h"
 #include "core/tensor.h"
 #include <algorithm>
 #include <cstdint>
@@ -8,40 +10,85 @@
 namespace infini
 {
 
+    /**
+     * @brief One step of a compiled graph: an operator together with its
+     * resolved kernel and the function bound to the operator's data.
+     */
+    struct Instruction
+    {
+        Operator op;
+        Kernel *kernel;
+        KernelFunc func;
+        // Positions in the plan of the steps that must wait for this one:
+        // its consumers, and the producers of tensors dataMalloc() placed
+        // in memory this step still touches. Steps not linked this way may
+        // run concurrently.
+        vector<size_t> successors;
+        size_t numPredecessors = 0;
+    };
+
+    /**
+     * @brief How topo_sort() picks the next operator when several are ready.
+     */
+    enum class TopoSortPolicy
+    {
+        // First ready, first emitted (breadth-first over the ready set).
+        Stable,
+        // Follow the operator just emitted into its consumers first, so a
+        // tensor is usually consumed while it is still in cache.
+        Locality,
+        // Prefer operators that release more input bytes than their outputs
+        // take, which keeps the live set small for dataMalloc().
+        Memory,
+    };
+
     class GraphObj : public Object
     {
     protected:
         Runtime runtime;
-        TensorVec tensors;
-        OpVec ops;
+        // Removal leaves a nullptr tombstone so that the positions of the
+        // other entries stay valid; compact() squeezes the tombstones out
+        // before anything walks the whole list.
+        mutable TensorVec tensors;
+        mutable OpVec ops;
         Allocator allocator;
 
     public:
         explicit GraphObj(Runtime runtime)
-            : runtime(runtime), allocator(runtime), sorted(false){};
+            : runtime(runtime), allocator(runtime), sorted(false),
+              compiled(false){};
         string toString() const override;
         Runtime getRuntime() const { return runtime; }
 
         Tensor addTensor(Shape dim, DataType dtype = DataType::Float32);
         Tensor addTensor(const Tensor &tensor);
         TensorVec addTensor(const TensorVec &tensors);
-        void removeOperator(Operator op)
+        /**
+         * @brief Remove an operator or a tensor in O(1). Connections are left
+         * to the caller. Removing something not in the graph does nothing.
+         */
+        void removeOperator(Operator op);
+        void removeTensor(Tensor tensor);
+
+        const TensorVec &getTensors() const
         {
-            auto it = std::find(ops.begin(), ops.end(), op);
-            if (it != ops.end())
-                ops.erase(it);
+            compact();
+            return tensors;
         }
-
-        void removeTensor(Tensor tensor)
+        const OpVec &getOperators() const
         {
-            auto it = std::find(tensors.begin(), tensors.end(), tensor);
-            if (it != tensors.end())
-                tensors.erase(it);
+            compact();
+            return ops;
         }
 
-        const TensorVec &getTensors() const { return tensors; }
-        const OpVec &getOperators() const { return ops; }
-        Tensor getTensor(int) const;
+        /**
+         * @brief Find a tensor by FUID or an operator by GUID in O(1).
+         * nullptr is returned if there is none.
+         */
+        Tensor getTensor(int fuid) const;
+        Operator getOperator(UidBaseType guid) const;
+        bool hasTensor(const Tensor &tensor) const;
+        bool hasOperator(const Operator &op) const;
 
         /**
          * @brief Sort the nodes in topological order.
@@ -51,12 +98,118 @@ namespace infini
          */
         bool topo_sort();
 
+        /**
+         * @brief Sort the nodes again with Kahn's algorithm, even if they are
+         * already sorted, breaking ties among ready operators by "policy".
+         * It runs in O(V + E) for Stable and Locality, and O(V log V + E) for
+         * Memory. The graph is left untouched when it has a ring.
+         */
+        bool topo_sort(TopoSortPolicy policy);
+
+        /**
+         * @brief Estimate the arena bytes dataMalloc() needs for the current
+         * order: the graph inputs and outputs plus the largest set of
+         * intermediates alive at once, each padded like the Allocator does.
+         * Fragmentation is not modelled, so this is a lower bound.
+         */
+        size_t estimatePeakMemory();
+
+        /**
+         * @brief Reorder the operators to lower estimatePeakMemory(). A
+         * greedy pass runs the ready operator that grows the live set least,
+         * then a branch-and-bound search over the ready sets tries up to
+         * "searchBudget" more steps, pruning every order whose peak already
+         * reaches the best one. The order is kept if nothing beats it.
+         * Returns the estimated peak of the chosen order.
+         */
+        size_t scheduleForMemory(size_t searchBudget = 1 << 14);
+
         void optimize();
 
+        /**
+         * @brief Evaluate every operator whose inputs are all constant once,
+         * with the CPU kernels, and replace it by its outputs as constant
+         * tensors. Constants left unused are removed, so a weight-only
+         * subgraph collapses into the one tensor it produces. Operators that
+         * produce graph outputs are kept. Returns the number folded.
+         */
+        size_t foldConstants();
+
+        /**
+         * @brief Merge operators of the same OpType, attributes
+         * (getOpAttrVector) and inputs, found by hashing them, so that each
+         * is computed once. Merges cascade through the graph in one
+         * topological sweep. An operator producing a graph output is kept.
+         * Returns the number of operators removed.
+         */
+        size_t eliminateCommonSubexpressions();
+
+        /**
+         * @brief Remove the operators none of the declared outputs depends on
+         * (see setOutputs). It does nothing if no output was declared, since
+         * then every unused tensor is an output. Returns the number of
+         * operators removed.
+         */
+        size_t eliminateDeadCode();
+
+        /**
+         * @brief Run "patterns" to a fixed point with a worklist. Every
+         * operator is tried once, and after a rewrite only the operators it
+         * touched and their neighbours are tried again. Returns the number of
+         * rewrites applied.
+         */
+        size_t applyPatterns(const RewritePatternSet &patterns);
+
+        /**
+         * @brief Add a copy of "op" that reads "inputs" and writes new output
+         * tensors, shaped for those inputs.
+         */
+        Operator cloneOperator(const Operator &op, const TensorVec &inputs);
+
+        /**
+         * @brief Make "op" read "to" wherever it reads "from", keeping the
+         * tensor targets and the operator links in sync.
+         */
+        void replaceInput(const Operator &op, const Tensor &from,
+                          const Tensor &to);
+
+        /**
+         * @brief Make every consumer of "from" read "to" instead.
+         */
+        void replaceAllUses(const Tensor &from, const Tensor &to);
+
+        /**
+         * @brief Make "op" write "to" instead of "from" and remove "from".
+         * "from" must have no consumers and "to" no source, and both must
+         * have the same shape and data type.
+         */
+        void replaceOutput(const Operator &op, const Tensor &from,
+                           const Tensor &to);
+
+        /**
+         * @brief Disconnect "op" and remove it, together with any input it
+         * leaves with neither a source nor a consumer. Its outputs must have
+         * no consumers left and are removed, unless "keepOutputs" is set: then
+         * they stay in the graph without a source, so that a new operator can
+         * be added with them as outputs.
+         */
+        void eraseOperator(const Operator &op, bool keepOutputs = false);
+
         void shape_infer();
 
         void dataMalloc();
 
+        /**
+         * @brief Resolve the kernel of every operator and bind it to the current
+         * data pointers and shapes, producing a flat instruction list that the
+         * runtime walks, with the dependencies between its steps. It must be
+         * called after dataMalloc(). Any change of the graph drops the plan,
+         * and the runtime compiles again on the next run.
+         */
+        void compile();
+        bool isCompiled() const { return compiled; }
+        const vector<Instruction> &getPlan() const { return plan; }
+
         /**
          * @brief Add an operator and create its outputs. Output tensor arguments
          * should be empty Refs (e.g., nullptr).
@@ -85,6 +238,7 @@ namespace infini
          */
         inline TensorVec getInputs() const
         {
+            compact();
             TensorVec ret;
             for (const auto &t : tensors)
                 if (!t->getSource())
@@ -93,17 +247,41 @@ namespace infini
         }
 
         /**
-         * @brief Gets output tensors of this graph.
+         * @brief Gets output tensors of this graph: the declared ones if
+         * setOutputs() was called, otherwise every tensor without consumers.
          */
         inline TensorVec getOutputs() const
         {
+            compact();
             TensorVec ret;
+            if (!declaredOutputs.empty())
+            {
+                for (const auto &t : declaredOutputs)
+                    if (hasTensor(t))
+                        ret.emplace_back(t);
+                return ret;
+            }
             for (const auto &t : tensors)
                 if (t->getTargets().empty())
                     ret.emplace_back(t);
             return ret;
         }
 
+        /**
+         * @brief Declare the outputs of this graph. A declared output keeps
+         * its memory even if other operators read it too.
+         */
+        void setOutputs(const TensorVec &outputs)
+        {
+            compiled = false;
+            declaredOutputs = outputs;
+        }
+        bool isDeclaredOutput(const Tensor &tensor) const
+        {
+            return std::find(declaredOutputs.begin(), declaredOutputs.end(),
+                             tensor) != declaredOutputs.end();
+        }
+
         bool checkValid() const;
 
     private:
@@ -112,10 +290,63 @@ namespace infini
          */
         void addOperatorAndConnect(const Operator &op);
 
+        /**
+         * @brief Drop the tombstones left by removals and refresh the
+         * position indexes. It is O(1) when nothing has been removed since the
+         * last call, so every whole-graph walk starts with it.
+         */
+        void compact() const;
+
+        /**
+         * @brief Rebuild the predecessor links of "op" from its inputs, and
+         * the matching successor links of its producers.
+         */
+        void relink(const Operator &op);
+
+        /**
+         * @brief While applyPatterns() runs, record "op" and its neighbours
+         * as operators to try again.
+         */
+        void touch(const Operator &op);
+
+        /**
+         * @brief Record the positions of ops[from...] or tensors[from...] in
+         * the indexes below.
+         */
+        void indexOperators(size_t from = 0) const;
+        void indexTensors(size_t from = 0) const;
+
         /**
          * @brief If the nodes is sorted in topological order.
          */
         bool sorted;
+
+        /**
+         * @brief If "plan" matches the current graph.
+         */
+        bool compiled;
+        vector<Instruction> plan;
+
+        /**
+         * @brief Outputs given to setOutputs(), empty if none were.
+         */
+        TensorVec declaredOutputs;
+
+        /**
+         * @brief Positions in "ops" and "tensors", keyed by GUID, and the
+         * position of the first tensor of each FUID. They cover live entries
+         * only.
+         */
+        mutable std::unordered_map<UidBaseType, size_t> opIndex;
+        mutable std::unordered_map<UidBaseType, size_t> tensorIndex;
+        mutable std::unordered_map<UidBaseType, size_t> fuidIndex;
+        mutable size_t deadOps = 0, deadTensors = 0;
+
+        /**
+         * @brief Operators touched by the running rewrite, if "rewriting".
+         */
+        bool rewriting = false;
+        vector<Operator> touched;
     };
 
 } // namespace infini
@@ -10,6 +10,13 @@ namespace infini
 
     class RuntimeObj;
 
+    /**
+     * @brief A kernel bound to one operator. Kernel lookup, data type dispatch,
+     * data pointers and shape metadata are resolved when it is created, so
+     * calling it only does the computation.
+     */
+    using KernelFunc = std::function<void()>;
+
     class Kernel
     {
     public:
@@ -21,6 +28,17 @@ namespace infini
          */
         virtual void compute(const Operator &op,
                              const RuntimeObj *context) const = 0;
+
+        /**
+         * @brief Binds this kernel to an op. The returned function stays valid
+         * as long as the op's tensors keep their shapes and data blobs.
+         */
+        virtual KernelFunc prepare(const Operator &op,
+                                   const RuntimeObj *context) const
+        {
+            return [this, op, context]()
+            { compute(op, context); };
+        }
     };
 
     class KernelRegistry
@@ -68,8 +86,13 @@ namespace infini
     class CpuKernelWithoutConfig : public Kernel
     {
     public:
-        virtual void compute(const Operator &op,
-                             const RuntimeObj *context) const = 0;
+        void compute(const Operator &op,
+                     const RuntimeObj *context) const override
+        {
+            prepare(op, context)();
+        }
+        virtual KernelFunc prepare(const Operator &op,
+                                   const RuntimeObj *context) const override = 0;
     };
 
 } // namespace infini
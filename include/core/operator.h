@@ -7,6 +7,16 @@ namespace infini
 {
     using KernelAttrs = std::tuple<Device, OpType::underlying_t>;
 
+    /**
+     * @brief Work done by one run of an operator: floating point operations
+     * and bytes read or written in memory.
+     */
+    struct OpCost
+    {
+        double flops = 0;
+        double bytes = 0;
+    };
+
     class GraphObj;
     class OperatorObj : public Object
     {
@@ -55,6 +65,20 @@ namespace infini
         virtual int numInputs() const = 0;
         virtual int numOutputs() const = 0;
 
+        /**
+         * @brief The OpType followed by every attribute that affects the
+         * result. Two operators of the same inputs compute the same outputs
+         * if and only if these are equal. Float attributes are stored by
+         * their bits.
+         */
+        virtual vector<int> getOpAttrVector() const = 0;
+
+        /**
+         * @brief Cost model for profiling. By default no arithmetic and every
+         * input and output moved once; operators that compute override it.
+         */
+        virtual OpCost getCost() const;
+
         /**
          * @brief Clone this operator and replace its inputs and outputs.
          *
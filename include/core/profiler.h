@@ -0,0 +1,102 @@
+#pragma once
+#include "core/graph.h"
+#include "utils/perf_counters.h"
+#include <mutex>
+
+namespace infini
+{
+
+    /**
+     * @brief Roofs of the roofline model: the best arithmetic and memory
+     * throughput this machine reaches.
+     */
+    struct MachinePeak
+    {
+        double gflops;
+        double gbps;
+
+        /**
+         * @brief Measure both once per process: GFLOP/s with the MatMul
+         * kernel on a 256x256x256 Float32 product, which is as fast as this
+         * runtime computes, and GB/s with a memcpy far larger than the last
+         * level cache, counting the bytes read and written.
+         */
+        static const MachinePeak &measure();
+    };
+
+    /**
+     * @brief Collects the time of every kernel run by a runtime it is set on
+     * (see NativeCpuRuntimeObj::setProfiler), together with the work of the
+     * operator from OperatorObj::getCost(). Runs are summed per kernel, and
+     * so per OpType, since an OpType has one kernel on a device.
+     */
+    class ProfilerObj : public Object
+    {
+    public:
+        struct Record
+        {
+            OpType opType;
+            string kernel;
+            size_t calls = 0;
+            double seconds = 0, flops = 0, bytes = 0;
+            // hardware event counts summed over the calls that had them
+            std::array<double, NUM_PERF_EVENTS> events{};
+            std::array<size_t, NUM_PERF_EVENTS> eventCalls{};
+            // calls whose counts miss work that ran on other threads
+            size_t partialCalls = 0;
+        };
+
+        /**
+         * @brief "peak" is measured when the first report is made if it is
+         * not given.
+         */
+        explicit ProfilerObj(optional<MachinePeak> peak = std::nullopt)
+            : peak(peak) {}
+
+        /**
+         * @brief Add one run of "instr" that took "seconds", with the
+         * hardware events counted meanwhile if any. "partial" tells that
+         * part of the kernel ran on other threads, which "events" miss.
+         * Safe to call from several threads.
+         */
+        void record(const Instruction &instr, double seconds,
+                    const PerfSample &events = {}, bool partial = false);
+        void reset();
+
+        /**
+         * @brief Have the runtime read PerfCounters around every kernel.
+         * They count the thread that runs the kernel, so the loop ranges a
+         * kernel forks onto other threads of the pool are not included; the
+         * report marks the kernels this happened to. Run with
+         * OMP_NUM_THREADS=1 to count everything.
+         */
+        void setHardwareCounters(bool enable) { hardwareCounters = enable; }
+        bool usesHardwareCounters() const { return hardwareCounters; }
+
+        /**
+         * @brief The records, most expensive first.
+         */
+        vector<Record> getRecords() const;
+
+        /**
+         * @brief A table of the records with the achieved GFLOP/s and GB/s,
+         * the arithmetic intensity, whether the kernel is compute-bound or
+         * memory-bound on this machine and how close it gets to its roof.
+         * With hardware counters, a second table gives the instructions per
+         * cycle and the LLC, dTLB and branch misses per KB moved.
+         */
+        string report();
+        string toString() const override { return "Profiler"; }
+
+    private:
+        void reportCounters(std::ostream &oss,
+                            const vector<Record> &rows) const;
+
+        optional<MachinePeak> peak;
+        bool hardwareCounters = false;
+        mutable std::mutex mutex;
+        std::unordered_map<const Kernel *, size_t> rowOf;
+        vector<Record> records;
+    };
+
+} // namespace infini
@@ -0,0 +1,63 @@
+#pragma once
+#include "core/op_type.h"
+#include "core/operator.h"
+
+namespace infini
+{
+
+    /**
+     * @brief A local rewrite rooted at one operator. It returns true if it
+     * changed the graph. A rewrite must change the graph only through the
+     * GraphObj helpers (addOp, addOpWithOutputs, cloneOperator,
+     * replaceInput, replaceAllUses, replaceOutput, eraseOperator), which
+     * tell the engine which operators
+     * to look at again. Mutating attributes of the root in place is fine, as
+     * the root is always revisited.
+     */
+    using RewriteFunc = std::function<bool(GraphObj &, const Operator &)>;
+
+    struct RewritePattern
+    {
+        string name;
+        RewriteFunc apply;
+    };
+
+    /**
+     * @brief Patterns grouped by the OpType of their root, in the order they
+     * were added. GraphObj::applyPatterns runs them to a fixed point.
+     */
+    class RewritePatternSet
+    {
+        std::unordered_map<OpType::underlying_t, vector<RewritePattern>>
+            patterns;
+
+    public:
+        RewritePatternSet &add(OpType root, string name, RewriteFunc apply);
+        const vector<RewritePattern> &get(OpType root) const;
+        bool empty() const { return patterns.empty(); }
+    };
+
+    /**
+     * @brief Compose chains of Transpose into one, cancelling those that
+     * compose to the identity. Sink Transpose below layout-agnostic ops
+     * (binary element-wise ops, Relu, Clip, narrowing Cast) so that it can
+     * meet another one. Fold a Transpose swapping the last two dimensions
+     * into MatMul, on either side of it.
+     */
+    void populateTransposePatterns(RewritePatternSet &patterns);
+
+    /**
+     * @brief Absorb the single Float32 consumer of a MatMul into its
+     * epilogue, as long as it is a bias or residual Add, Relu or Clip.
+     */
+    void populateEpiloguePatterns(RewritePatternSet &patterns);
+
+    /**
+     * @brief Fuse chains of floating point Add, Sub, Mul, Div, Relu, Clip
+     * and Cast into FusedElementWise operators, so that the intermediate
+     * tensors are never written out. A producer is only fused into its
+     * single consumer, and only if its output is not broadcast there.
+     */
+    void populateFusionPatterns(RewritePatternSet &patterns);
+
+} // namespace infini
@@ -10,12 +10,16 @@ namespace infini
   class GraphObj;
   class RuntimeObj;
   class BlobObj;
+  class ProfilerObj;
+  class TracerObj;
 
   using Tensor = Ref<TensorObj>;
   using Operator = Ref<OperatorObj>;
   using Graph = Ref<GraphObj>;
   using Runtime = Ref<RuntimeObj>;
   using Blob = Ref<BlobObj>;
+  using Profiler = Ref<ProfilerObj>;
+  using Tracer = Ref<TracerObj>;
 
   using TensorVec = vector<Tensor>;
   using OpVec = vector<Operator>;
@@ -29,6 +33,7 @@ namespace infini
   {
   protected:
     Device device;
+    Tracer tracer;
 
   public:
     explicit RuntimeObj(Device device)
@@ -46,11 +51,23 @@ namespace infini
       return true;
     }
 
+    Device getDevice() const { return device; }
+
+    /**
+     * @brief Record the kernels run and the arena placed by dataMalloc() on
+     * this runtime into "tracer"; nullptr turns tracing off.
+     */
+    void setTracer(Tracer tracer) { this->tracer = tracer; }
+    Tracer getTracer() const { return tracer; }
+
     virtual string toString() const = 0;
   };
 
   class NativeCpuRuntimeObj : public RuntimeObj
   {
+    bool parallel = false;
+    Profiler profiler;
+
   public:
     NativeCpuRuntimeObj() : RuntimeObj(Device::CPU) {}
 
@@ -62,6 +79,25 @@ namespace infini
     }
     void dealloc(void *ptr) override;
     void run(const Graph &graph) const override;
+
+    /**
+     * @brief Run the steps of a plan on the shared ThreadPool as soon as
+     * the steps they depend on are done, so that independent branches of a
+     * graph overlap. Kernels fork their loops on the same pool; a kernel
+     * waiting for its loop never picks up another step, so steps do not
+     * nest on one thread.
+     */
+    void setParallel(bool parallel) { this->parallel = parallel; }
+    bool isParallel() const { return parallel; }
+
+    /**
+     * @brief Time every kernel run into "profiler" with a steady clock;
+     * nullptr turns profiling off. A kernel is charged its exclusive time,
+     * in parallel mode too: should a step ever run nested inside another
+     * on one thread, the outer one does not count its time or events.
+     */
+    void setProfiler(Profiler profiler) { this->profiler = profiler; }
+    Profiler getProfiler() const { return profiler; }
     void *alloc(size_t size) override;
     string toString() const override;
   };
@@ -24,6 +24,9 @@ namespace infini
         WRef<OperatorObj> source;
         Blob data;
         Runtime runtime;
+        // Storage of a constant tensor, owned by the tensor instead of the
+        // graph's arena.
+        std::shared_ptr<void> constantData;
 
     private:
         Shape shape;
@@ -49,6 +52,15 @@ namespace infini
 
         void setDataBlob(const Blob &blob);
 
+        /**
+         * @brief Mark the tensor as a constant (an initializer such as a
+         * weight). It gets zeroed storage of its own right away, so its data
+         * can be set with setData() before the graph is optimized, and
+         * dataMalloc() leaves it out of the arena.
+         */
+        void setConstant();
+        bool isConstant() const { return constantData != nullptr; }
+
         void printData() const;
         bool equalData(const Tensor &rhs, double relativeError = 1e-6) const;
 
@@ -139,6 +151,12 @@ namespace infini
                         return false;
                     }
                 }
+                else if constexpr (isHalfType<T>)
+                {
+                    float x = toCompute(a[i]), y = toCompute(b[i]);
+                    if (!equalDataImpl(&x, &y, 1, relativeError))
+                        return false;
+                }
                 else
                 {
                     static_assert(!sizeof(T), "Unsupported data type");
@@ -0,0 +1,75 @@
+#pragma once
+#include "core/graph.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace infini
+{
+
+    /**
+     * @brief Records a timeline of a runtime it is set on (see
+     * RuntimeObj::setTracer) in the Chrome Trace Event format, which
+     * chrome://tracing and Perfetto open. Every kernel run becomes a
+     * complete event on the thread that ran it, with the op GUID, kernel
+     * name and input shapes as arguments. dataMalloc() adds an instant
+     * event for every tensor placed in or released from the arena, and a
+     * counter of the bytes in use.
+     */
+    class TracerObj : public Object
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        TracerObj() : origin(Clock::now()) {}
+
+        /**
+         * @brief Add one run of "instr". Safe to call from several threads.
+         */
+        void recordOp(const Instruction &instr, Clock::time_point start,
+                      Clock::time_point end);
+
+        /**
+         * @brief Add an arena event of dataMalloc(): "tensor" got (or gave
+         * back, if "release") the bytes at "offset", leaving "inUse" bytes of
+         * the arena taken.
+         */
+        void recordMemory(const Tensor &tensor, size_t offset, bool release,
+                          size_t inUse);
+
+        size_t size() const;
+        void clear();
+
+        /**
+         * @brief The trace as a JSON object with a "traceEvents" array.
+         */
+        string toJson() const;
+
+        /**
+         * @brief Write toJson() to "path". Throws if it cannot be written.
+         */
+        void save(const string &path) const;
+        string toString() const override { return "Tracer"; }
+
+    private:
+        struct Event
+        {
+            char phase;
+            string name, category;
+            double timestamp, duration; // in microseconds since origin
+            int thread;
+            string args; // a rendered JSON object
+        };
+
+        double microseconds(Clock::time_point t) const;
+        // Small thread numbers in order of first appearance; the caller must
+        // hold "mutex".
+        int threadIndex(std::thread::id id);
+
+        Clock::time_point origin;
+        mutable std::mutex mutex;
+        vector<std::thread::id> threads;
+        vector<Event> events;
+    };
+
+} // namespace infini
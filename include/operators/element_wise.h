@@ -26,6 +26,8 @@ namespace infini
     optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
 
     std::string toString() const override;
+    vector<int> getOpAttrVector() const override;
+    OpCost getCost() const override;
     int numInputs() const override { return 2; }
     int numOutputs() const override { return 1; }
     };
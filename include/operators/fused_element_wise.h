@@ -0,0 +1,56 @@
+#pragma once
+#include "core/operator.h"
+
+namespace infini
+{
+  /**
+   * @brief One step of a fused element-wise expression. Values are numbered
+   * with the inputs first and then one per step, and "lhs"/"rhs" refer to
+   * earlier values. "rhs" is only used by binary steps, and "min"/"max" only
+   * by Clip, where a missing bound is infinite. "dtype" is the data type of
+   * the result: Float16 and BFloat16 results are rounded like the unfused
+   * operator would store them, and a Cast step is just that rounding.
+   */
+  struct FusedStep
+  {
+    OpType type;
+    int lhs, rhs;
+    float min, max;
+    DataType dtype;
+  };
+
+  /**
+   * @brief A chain of Add, Sub, Mul, Div, Relu, Clip and floating point Cast
+   * operators evaluated in a single pass over the output. Inputs broadcast
+   * against the output like the inputs of ElementWiseObj, and the result of
+   * the last step is the output.
+   *
+   */
+  class FusedElementWiseObj : public OperatorObj
+  {
+  public:
+    /**
+     * @brief Construct a new FusedElementWise object.
+     *
+     * @param graph The computation graph that this operator belongs to.
+     * @param inputs The input tensors, values 0 to inputs.size() - 1.
+     * @param output The output tensor.
+     * @param steps The expression, in evaluation order.
+     */
+    FusedElementWiseObj(GraphObj *graph, TensorVec inputs, Tensor output,
+                        vector<FusedStep> steps);
+    OP_CLONE(FusedElementWiseObj);
+    optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+    vector<DataType> inferDataType(const TensorVec &inputs) const override;
+
+    std::string toString() const override;
+    vector<int> getOpAttrVector() const override;
+    OpCost getCost() const override;
+    int numInputs() const override { return inputs.size(); }
+    int numOutputs() const override { return 1; }
+    const vector<FusedStep> &getSteps() const { return steps; }
+
+  private:
+    vector<FusedStep> steps;
+  };
+} // namespace infini
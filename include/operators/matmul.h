@@ -3,6 +3,26 @@
 
 namespace infini
 {
+    /**
+     * @brief One element-wise step applied to the output of a MatMul while
+     * it is still in cache, in the order of the epilogue. Bias adds a tensor
+     * broadcast along the rows, whose last dim is N and the others 1.
+     * Residual adds a tensor of the output shape. Both read the next input
+     * after A and B. Clip uses "min" and "max", where a missing bound is
+     * infinite.
+     */
+    struct MatmulEpilogue
+    {
+        enum Kind
+        {
+            Bias,
+            Residual,
+            Relu,
+            Clip,
+        } kind;
+        float min, max;
+    };
+
     /**
      * @brief Matrix multiplication.
      *
@@ -15,6 +35,9 @@ namespace infini
         // oppsite to the column-major BLAS.
         bool transA, transB;
 
+        // Element-wise steps applied to the result, see MatmulEpilogue.
+        vector<MatmulEpilogue> epilogue;
+
         // Auxiliary attributes which are not a part of operator attributes.
         int m, n, k;
 
@@ -40,10 +63,19 @@ namespace infini
          */
         MatmulObj(GraphObj *graph, Tensor A, Tensor B, Tensor C,
                   bool transA = false, bool transB = false);
+
+        /**
+         * @brief Matmul with an epilogue. "inputs" are A and B followed by
+         * one tensor for each Bias or Residual step of "epilogue".
+         */
+        MatmulObj(GraphObj *graph, TensorVec inputs, Tensor C, bool transA,
+                  bool transB, vector<MatmulEpilogue> epilogue);
         OP_CLONE(MatmulObj);
 
         std::string toString() const override;
         optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+        vector<int> getOpAttrVector() const override;
+        OpCost getCost() const override;
 
         int numInputs() const override { return inputs.size(); }
         int numOutputs() const override { return 1; }
@@ -52,6 +84,7 @@ namespace infini
         bool getTransB() const { return transB; }
         void setTransA(bool transA) { this->transA = transA; }
         void setTransB(bool transB) { this->transB = transB; }
+        const vector<MatmulEpilogue> &getEpilogue() const { return epilogue; }
         int getM() const { return m; }
         int getN() const { return n; }
         int getK() const { return k; }
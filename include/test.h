@@ -1,4 +1,74 @@
 #pragma once
 #include "core/common.h"
+#include "core/graph.h"
+#include "core/runtime.h"
 #include "utils/data_generator.h"
 #include "gtest/gtest.h"
+#include <functional>
+
+namespace infini
+{
+    /**
+     * @brief The number of operators of type "type" in "g".
+     */
+    inline int countOps(const Graph &g, OpType type)
+    {
+        int n = 0;
+        for (auto &op : g->getOperators())
+            n += op->getOpType() == type;
+        return n;
+    }
+
+    /**
+     * @brief Builds a graph twice with "build" on Float32 inputs of
+     * "shapes", applies "transform" to the second copy only, runs both with
+     * the inputs still in the graph filled by "generator", and checks that
+     * they compute the same output. Returns the transformed graph.
+     */
+    inline Graph
+    checkTransform(const vector<Shape> &shapes,
+                   const std::function<Tensor(Graph, TensorVec)> &build,
+                   const std::function<void(Graph, TensorVec)> &transform,
+                   double relativeError = 1e-6,
+                   const std::function<void(void *, size_t, DataType)>
+                       &generator = ScrambledGenerator())
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Tensor outputs[2];
+        Graph graphs[2];
+        for (int k = 0; k < 2; ++k)
+        {
+            Graph g = graphs[k] = make_ref<GraphObj>(runtime);
+            TensorVec inputs;
+            for (auto &shape : shapes)
+                inputs.emplace_back(g->addTensor(shape, DataType::Float32));
+            outputs[k] = build(g, inputs);
+            if (k == 1)
+                transform(g, inputs);
+            EXPECT_TRUE(g->checkValid());
+            g->dataMalloc();
+            for (auto &input : inputs)
+                if (g->hasTensor(input))
+                    input->setData(generator);
+            runtime->run(g);
+        }
+        EXPECT_TRUE(outputs[1]->equalData(outputs[0], relativeError));
+        return graphs[1];
+    }
+
+    /**
+     * @brief checkTransform() with optimize() as the transform.
+     */
+    inline Graph
+    checkOptimize(const vector<Shape> &shapes,
+                  const std::function<Tensor(Graph, TensorVec)> &build,
+                  double relativeError = 1e-6,
+                  const std::function<void(void *, size_t, DataType)>
+                      &generator = ScrambledGenerator())
+    {
+        return checkTransform(
+            shapes, build, [](Graph g, TensorVec) { g->optimize(); },
+            relativeError, generator);
+    }
+
+} // namespace infini
@@ -0,0 +1,30 @@
+#pragma once
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <cstddef>
+
+namespace infini {
+
+// Instruction set levels the CPU kernels can dispatch on, ordered so that a
+// higher level implies every lower one.
+enum class CpuIsa {
+    Generic = 0,
+    SSE42,  // SSE4.2
+    AVX2,   // AVX2 + FMA + F16C
+    AVX512, // AVX-512 F/BW/DQ/VL
+};
+
+// Detect the best instruction set level of the running CPU. The result is
+// computed once and cached.
+CpuIsa getCpuIsa();
+
+const char *cpuIsaToString(CpuIsa isa);
+
+// Size in bytes of the last level data cache, cached like getCpuIsa(). Falls
+// back to a conservative guess when the OS does not report it.
+size_t getLastLevelCacheSize();
+
+} // namespace infini
+
+#endif
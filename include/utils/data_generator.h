@@ -56,4 +56,27 @@ template <int val> class ValGenerator : public DataGenerator {
 };
 typedef ValGenerator<1> OneGenerator;
 typedef ValGenerator<0> ZeroGenerator;
+
+// The integers -5 to 5 in a scrambled order, times "scale" for Float32.
+// Small values keep sums and products exact, so an optimized graph can be
+// compared bit-for-bit with the original one.
+class ScrambledGenerator : public DataGenerator {
+  public:
+    explicit ScrambledGenerator(float scale = 1) : scale(scale) {}
+    virtual ~ScrambledGenerator() {}
+
+  private:
+    void fill(uint32_t *data, size_t size) override {
+        for (size_t i = 0; i < size; i++) {
+            data[i] = i * 37 % 11;
+        }
+    }
+    void fill(float *data, size_t size) override {
+        for (size_t i = 0; i < size; i++) {
+            data[i] = float(int(i * 37 % 11) - 5) * scale;
+        }
+    }
+
+    float scale;
+};
 } // namespace infini
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef GRAPH_GENERATOR_H
+#define GRAPH_GENERATOR_H
+
+#include "core/graph.h"
+
+namespace infini {
+
+// The shape of the DAGs made by generateGraph().
+enum class GraphTopology {
+    // Every operator reads the tensor produced just before it, so the
+    // depth equals the number of operators.
+    Chain,
+    // Operators read tensors picked uniformly from all produced so far,
+    // so early tensors feed many consumers and the graph stays shallow.
+    FanOut,
+    // Mostly Transpose, including pairs that cancel each other.
+    TransposeHeavy,
+    // Mostly Concat, each group of them brought back to the working shape
+    // by a MatMul.
+    ConcatHeavy,
+    // A bit of everything above.
+    Mixed,
+};
+
+const char *graphTopologyToString(GraphTopology topology);
+
+struct GraphGeneratorConfig {
+    GraphTopology topology = GraphTopology::Mixed;
+    // The graph gets at least this many operators; a Concat group may add
+    // up to two more.
+    size_t numOps = 1000;
+    size_t numInputs = 4;
+    // Every tensor has this shape, except the Concat results. Its
+    // dimensions should be equal so that any permutation keeps it.
+    Shape shape{4, 4, 4};
+    DataType dtype = DataType::Float32;
+    unsigned seed = 0;
+};
+
+// Build a random but valid graph from the existing operators: Add, Sub,
+// Mul, Relu, Clip, Transpose, Concat and MatMul. Every input is read and
+// every tensor nobody reads is an output. The same config always gives
+// the same graph.
+Graph generateGraph(Runtime runtime, const GraphGeneratorConfig &config);
+
+} // namespace infini
+
+#endif
@@ -0,0 +1,108 @@
+#pragma once
+#ifndef HALF_H
+#define HALF_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+
+// Storage types and scalar conversions of the 16-bit floating point data
+// types. Both only carry the bits; arithmetic goes through float. The
+// conversions round to nearest even, like the F16C instructions.
+
+namespace infini {
+
+// IEEE 754 binary16, DataType::Float16.
+struct fp16_t {
+    uint16_t bits;
+};
+// Upper half of a binary32, DataType::BFloat16.
+struct bf16_t {
+    uint16_t bits;
+};
+
+inline uint32_t floatToBits(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+inline float bitsToFloat(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Exponent rebias and subnormal handling are done with float arithmetic, so
+// the hardware performs the rounding (see the FP16 library by M. Dukhan).
+inline fp16_t floatToFp16(float f) {
+    float base = (std::abs(f) * 0x1.0p+112f) * 0x1.0p-110f;
+    uint32_t w = floatToBits(f), shl1W = w + w, sign = w & 0x80000000u;
+    uint32_t bias = shl1W & 0xFF000000u;
+    if (bias < 0x71000000u)
+        bias = 0x71000000u;
+    base = bitsToFloat((bias >> 1) + 0x07800000u) + base;
+    uint32_t bits = floatToBits(base);
+    uint32_t nonSign = ((bits >> 13) & 0x7C00u) + (bits & 0x0FFFu);
+    return {uint16_t((sign >> 16) | (shl1W > 0xFF000000u ? 0x7E00u : nonSign))};
+}
+
+inline float fp16ToFloat(fp16_t h) {
+    uint32_t w = uint32_t(h.bits) << 16, sign = w & 0x80000000u, twoW = w + w;
+    float normalized = bitsToFloat((twoW >> 4) + (0xE0u << 23)) * 0x1.0p-112f;
+    float denormalized = bitsToFloat((twoW >> 17) | (126u << 23)) - 0.5f;
+    return bitsToFloat(sign | floatToBits(twoW < (1u << 27) ? denormalized
+                                                             : normalized));
+}
+
+// NaNs stay NaN (quieted) instead of rounding into infinity.
+inline bf16_t floatToBf16(float f) {
+    uint32_t w = floatToBits(f);
+    if ((w & 0x7FFFFFFFu) > 0x7F800000u)
+        return {uint16_t((w >> 16) | 0x40u)};
+    return {uint16_t((w + 0x7FFFu + ((w >> 16) & 1u)) >> 16)};
+}
+
+inline float bf16ToFloat(bf16_t b) {
+    return bitsToFloat(uint32_t(b.bits) << 16);
+}
+
+template <typename T>
+constexpr bool isHalfType =
+    std::is_same_v<T, fp16_t> || std::is_same_v<T, bf16_t>;
+
+// Type the math on T is done in: float for the 16-bit storage types, T
+// itself otherwise.
+template <typename T>
+using ComputeType = std::conditional_t<isHalfType<T>, float, T>;
+
+template <typename T> ComputeType<T> toCompute(T v) {
+    if constexpr (std::is_same_v<T, fp16_t>)
+        return fp16ToFloat(v);
+    else if constexpr (std::is_same_v<T, bf16_t>)
+        return bf16ToFloat(v);
+    else
+        return v;
+}
+
+template <typename T> T fromCompute(ComputeType<T> v) {
+    if constexpr (std::is_same_v<T, fp16_t>)
+        return floatToFp16(v);
+    else if constexpr (std::is_same_v<T, bf16_t>)
+        return floatToBf16(v);
+    else
+        return v;
+}
+
+inline std::ostream &operator<<(std::ostream &os, fp16_t v) {
+    return os << fp16ToFloat(v);
+}
+inline std::ostream &operator<<(std::ostream &os, bf16_t v) {
+    return os << bf16ToFloat(v);
+}
+
+} // namespace infini
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace infini {
+
+// Hardware events counted around each kernel when a profiler asks for them.
+enum class PerfEvent {
+    Cycles,
+    Instructions,
+    LLCMisses,
+    DTLBMisses,
+    BranchMisses,
+};
+constexpr size_t NUM_PERF_EVENTS = 5;
+
+const char *perfEventToString(PerfEvent event);
+
+// Counts of every event; "valid" tells which ones could be read. The
+// events are counted as one group, so they share the time the group was
+// enabled and the time it actually ran on the PMU, in nanoseconds.
+struct PerfSample {
+    std::array<uint64_t, NUM_PERF_EVENTS> values{};
+    std::array<bool, NUM_PERF_EVENTS> valid{};
+    uint64_t timeEnabled = 0, timeRunning = 0;
+
+    // Counts between "before" and this sample, valid where both are. If
+    // the group was multiplexed with other events meanwhile, the counts are
+    // scaled up by enabled / running time to estimate the whole interval;
+    // if it never ran, none is valid.
+    PerfSample operator-(const PerfSample &before) const;
+};
+
+// The events above counted for the calling thread in user space through
+// Linux perf_event_open, as one group led by the first event that opens,
+// so that they are always measured over the same window. An event the
+// kernel, the CPU or the permissions (perf_event_paranoid) do not allow is
+// left out, and on other systems none is available; reading then just
+// returns invalid counts.
+class PerfCounters {
+  public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // The counters of the calling thread, opened on first use.
+    static PerfCounters &forThisThread();
+
+    bool available(PerfEvent event) const {
+        return fds[size_t(event)] >= 0;
+    }
+    bool anyAvailable() const;
+    PerfSample read() const;
+
+  private:
+    std::array<int, NUM_PERF_EVENTS> fds;
+    int leader = -1;
+};
+
+} // namespace infini
+
+#endif
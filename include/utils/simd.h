@@ -0,0 +1,437 @@
+#pragma once
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "utils/cpu_features.h"
+#include "utils/half.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INFINI_SIMD_X86 1
+#endif
+
+// Row loops of the element-wise CPU kernels. Every loop is compiled once per
+// instruction set through the target attribute and the best one for the
+// running CPU is picked by getCpuIsa(), so a single build runs at full width
+// on every x86 generation.
+
+namespace infini {
+
+// Scalar semantics of the operators; the vector forms below match them,
+// including which operand wins for NaN in Max/Min.
+struct AddOp {
+    template <typename T> T operator()(T a, T b) const { return a + b; }
+};
+struct SubOp {
+    template <typename T> T operator()(T a, T b) const { return a - b; }
+};
+struct MulOp {
+    template <typename T> T operator()(T a, T b) const { return a * b; }
+};
+struct DivOp {
+    template <typename T> T operator()(T a, T b) const { return (T)(a / b); }
+};
+struct MaxOp {
+    template <typename T> T operator()(T a, T b) const { return a > b ? a : b; }
+};
+struct MinOp {
+    template <typename T> T operator()(T a, T b) const { return a < b ? a : b; }
+};
+
+// out[i] = op(a[i * sa], b[i * sb]), where sa and sb are 0 or 1.
+template <typename T>
+using BinaryRowFunc = void (*)(T *out, const T *a, const T *b, size_t n,
+                               size_t sa, size_t sb);
+// out[i] = min(hi, max(lo, in[i])).
+template <typename T>
+using ClampRowFunc = void (*)(T *out, const T *in, size_t n, T lo, T hi);
+
+template <typename T, typename Op>
+void binaryRowGeneric(T *out, const T *a, const T *b, size_t n, size_t sa,
+                      size_t sb) {
+    Op op;
+    if (sa && sb)
+        for (size_t i = 0; i < n; ++i)
+            out[i] = op(a[i], b[i]);
+    else
+        for (size_t i = 0; i < n; ++i)
+            out[i] = op(a[i * sa], b[i * sb]);
+}
+
+template <typename T>
+void clampRowGeneric(T *out, const T *in, size_t n, T lo, T hi) {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = MinOp()(hi, MaxOp()(lo, in[i]));
+}
+
+#ifdef INFINI_SIMD_X86
+
+#define INFINI_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define INFINI_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define INFINI_TARGET_AVX512                                                   \
+    __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl")))
+
+// Vec<isa, T> wraps one register of T for an instruction set. supports<Op>
+// tells whether Op has a vector form; the others fall back to scalar code.
+template <CpuIsa isa, typename T> struct Vec;
+
+#define DEFINE_VEC(ISA, TARGET, T, REG, WIDTH, LOAD, STORE, SET1, ADD, SUB,    \
+                   MUL, DIV, MAX, MIN)                                         \
+    template <> struct Vec<CpuIsa::ISA, T> {                                   \
+        using reg = REG;                                                       \
+        static constexpr size_t width = WIDTH;                                 \
+        template <typename Op>                                                 \
+        static constexpr bool supports =                                       \
+            !std::is_same_v<Op, DivOp> || std::is_floating_point_v<T>;         \
+        TARGET static reg load(const T *p) { return LOAD(p); }                 \
+        TARGET static void store(T *p, reg v) { STORE(p, v); }                 \
+        TARGET static reg set1(T v) { return SET1(v); }                        \
+        template <typename Op> TARGET static reg apply(reg a, reg b) {         \
+            if constexpr (std::is_same_v<Op, AddOp>)                           \
+                return ADD(a, b);                                              \
+            else if constexpr (std::is_same_v<Op, SubOp>)                      \
+                return SUB(a, b);                                              \
+            else if constexpr (std::is_same_v<Op, MulOp>)                      \
+                return MUL(a, b);                                              \
+            else if constexpr (std::is_same_v<Op, DivOp>)                      \
+                return DIV(a, b);                                              \
+            else if constexpr (std::is_same_v<Op, MaxOp>)                      \
+                return MAX(a, b);                                              \
+            else if constexpr (std::is_same_v<Op, MinOp>)                      \
+                return MIN(a, b);                                              \
+            else                                                               \
+                static_assert(!sizeof(Op), "Unsupported vector op");           \
+        }                                                                      \
+    };
+
+// No integer division in SSE/AVX; DIV is never instantiated for UInt32.
+#define _VEC_NO_DIV(a, b) a
+#define _SSE_LOADU_I(p) _mm_loadu_si128(reinterpret_cast<const __m128i *>(p))
+#define _SSE_STOREU_I(p, v) _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v)
+#define _SSE_SET1_U32(v) _mm_set1_epi32((int)(v))
+#define _AVX_LOADU_I(p)                                                        \
+    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))
+#define _AVX_STOREU_I(p, v)                                                    \
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v)
+#define _AVX_SET1_U32(v) _mm256_set1_epi32((int)(v))
+#define _AVX512_SET1_U32(v) _mm512_set1_epi32((int)(v))
+// The unmasked AVX-512 max/min intrinsics trip GCC's maybe-uninitialized
+// warning on their undefined pass-through operand; a full zero-mask avoids it.
+#define _AVX512_MAX_PS(a, b) _mm512_maskz_max_ps(0xFFFF, a, b)
+#define _AVX512_MIN_PS(a, b) _mm512_maskz_min_ps(0xFFFF, a, b)
+#define _AVX512_MAX_U32(a, b) _mm512_maskz_max_epu32(0xFFFF, a, b)
+#define _AVX512_MIN_U32(a, b) _mm512_maskz_min_epu32(0xFFFF, a, b)
+
+DEFINE_VEC(SSE42, INFINI_TARGET_SSE42, float, __m128, 4, _mm_loadu_ps,
+           _mm_storeu_ps, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps,
+           _mm_div_ps, _mm_max_ps, _mm_min_ps)
+DEFINE_VEC(SSE42, INFINI_TARGET_SSE42, uint32_t, __m128i, 4, _SSE_LOADU_I,
+           _SSE_STOREU_I, _SSE_SET1_U32, _mm_add_epi32, _mm_sub_epi32,
+           _mm_mullo_epi32, _VEC_NO_DIV, _mm_max_epu32, _mm_min_epu32)
+DEFINE_VEC(AVX2, INFINI_TARGET_AVX2, float, __m256, 8, _mm256_loadu_ps,
+           _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps,
+           _mm256_mul_ps, _mm256_div_ps, _mm256_max_ps, _mm256_min_ps)
+DEFINE_VEC(AVX2, INFINI_TARGET_AVX2, uint32_t, __m256i, 8, _AVX_LOADU_I,
+           _AVX_STOREU_I, _AVX_SET1_U32, _mm256_add_epi32, _mm256_sub_epi32,
+           _mm256_mullo_epi32, _VEC_NO_DIV, _mm256_max_epu32,
+           _mm256_min_epu32)
+DEFINE_VEC(AVX512, INFINI_TARGET_AVX512, float, __m512, 16, _mm512_loadu_ps,
+           _mm512_storeu_ps, _mm512_set1_ps, _mm512_add_ps, _mm512_sub_ps,
+           _mm512_mul_ps, _mm512_div_ps, _AVX512_MAX_PS, _AVX512_MIN_PS)
+DEFINE_VEC(AVX512, INFINI_TARGET_AVX512, uint32_t, __m512i, 16,
+           _mm512_loadu_si512, _mm512_storeu_si512, _AVX512_SET1_U32,
+           _mm512_add_epi32, _mm512_sub_epi32, _mm512_mullo_epi32, _VEC_NO_DIV,
+           _AVX512_MAX_U32, _AVX512_MIN_U32)
+
+#undef _VEC_NO_DIV
+#undef _SSE_LOADU_I
+#undef _SSE_STOREU_I
+#undef _SSE_SET1_U32
+#undef _AVX_LOADU_I
+#undef _AVX_STOREU_I
+#undef _AVX_SET1_U32
+#undef _AVX512_SET1_U32
+#undef _AVX512_MAX_PS
+#undef _AVX512_MIN_PS
+#undef _AVX512_MAX_U32
+#undef _AVX512_MIN_U32
+#undef DEFINE_VEC
+
+// The loops carry the same target attribute as the Vec members so that the
+// wrappers are inlined into them.
+#define DEFINE_SIMD_LOOPS(ISA, TARGET)                                         \
+    template <typename T, typename Op>                                         \
+    TARGET void binaryRow##ISA(T *out, const T *a, const T *b, size_t n,       \
+                               size_t sa, size_t sb) {                         \
+        using V = Vec<CpuIsa::ISA, T>;                                         \
+        size_t i = 0;                                                          \
+        if constexpr (V::template supports<Op>) {                              \
+            if (sa && sb)                                                      \
+                for (; i + V::width <= n; i += V::width)                       \
+                    V::store(out + i, V::template apply<Op>(V::load(a + i),    \
+                                                            V::load(b + i)));  \
+            else if (sa) {                                                     \
+                auto vb = V::set1(*b);                                         \
+                for (; i + V::width <= n; i += V::width)                       \
+                    V::store(out + i,                                          \
+                             V::template apply<Op>(V::load(a + i), vb));       \
+            } else if (sb) {                                                   \
+                auto va = V::set1(*a);                                         \
+                for (; i + V::width <= n; i += V::width)                       \
+                    V::store(out + i,                                          \
+                             V::template apply<Op>(va, V::load(b + i)));       \
+            }                                                                  \
+        }                                                                      \
+        Op op;                                                                 \
+        for (; i < n; ++i)                                                     \
+            out[i] = op(a[i * sa], b[i * sb]);                                 \
+    }                                                                          \
+                                                                               \
+    template <typename T>                                                      \
+    TARGET void clampRow##ISA(T *out, const T *in, size_t n, T lo, T hi) {     \
+        using V = Vec<CpuIsa::ISA, T>;                                         \
+        auto vlo = V::set1(lo), vhi = V::set1(hi);                             \
+        size_t i = 0;                                                          \
+        for (; i + V::width <= n; i += V::width)                               \
+            V::store(out + i,                                                  \
+                     V::template apply<MinOp>(                                 \
+                         vhi, V::template apply<MaxOp>(vlo, V::load(in + i))));\
+        for (; i < n; ++i)                                                     \
+            out[i] = MinOp()(hi, MaxOp()(lo, in[i]));                          \
+    }
+
+DEFINE_SIMD_LOOPS(SSE42, INFINI_TARGET_SSE42)
+DEFINE_SIMD_LOOPS(AVX2, INFINI_TARGET_AVX2)
+DEFINE_SIMD_LOOPS(AVX512, INFINI_TARGET_AVX512)
+#undef DEFINE_SIMD_LOOPS
+
+// Copies that bypass the cache with non-temporal stores, for outputs too
+// large to stay cached anyway. The destination head is copied normally up to
+// the first aligned address.
+#define DEFINE_STREAM_COPY(ISA, TARGET, REG, LOADU, STREAM)                    \
+    TARGET inline void streamCopy##ISA(void *dst, const void *src,             \
+                                       size_t bytes) {                         \
+        constexpr size_t W = sizeof(REG);                                      \
+        auto d = static_cast<char *>(dst);                                     \
+        auto s = static_cast<const char *>(src);                               \
+        size_t head = (W - (uintptr_t)d % W) % W;                              \
+        if (bytes < head + W) {                                                \
+            std::memcpy(d, s, bytes);                                          \
+            return;                                                            \
+        }                                                                      \
+        std::memcpy(d, s, head);                                               \
+        size_t i = head;                                                       \
+        for (; i + W <= bytes; i += W)                                         \
+            STREAM(reinterpret_cast<REG *>(d + i),                             \
+                   LOADU(reinterpret_cast<const REG *>(s + i)));               \
+        std::memcpy(d + i, s + i, bytes - i);                                  \
+        _mm_sfence();                                                          \
+    }
+
+DEFINE_STREAM_COPY(SSE42, INFINI_TARGET_SSE42, __m128i, _mm_loadu_si128,
+                   _mm_stream_si128)
+DEFINE_STREAM_COPY(AVX2, INFINI_TARGET_AVX2, __m256i, _mm256_loadu_si256,
+                   _mm256_stream_si256)
+#undef DEFINE_STREAM_COPY
+
+// Eight 16-bit floating point values widened to float lanes and narrowed
+// back, rounding like floatToFp16/floatToBf16.
+INFINI_TARGET_AVX2 inline __m256 widen8(const fp16_t *p) {
+    return _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+INFINI_TARGET_AVX2 inline __m256 widen8(const bf16_t *p) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    return _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_cvtepu16_epi32(v), 16));
+}
+INFINI_TARGET_AVX2 inline void narrow8(fp16_t *p, __m256 v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                     _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+}
+INFINI_TARGET_AVX2 inline void narrow8(bf16_t *p, __m256 v) {
+    __m256i w = _mm256_castps_si256(v);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(w, 16),
+                                   _mm256_set1_epi32(1));
+    __m256i rounded = _mm256_srli_epi32(
+        _mm256_add_epi32(w, _mm256_add_epi32(_mm256_set1_epi32(0x7FFF), lsb)),
+        16);
+    __m256i quietNan =
+        _mm256_or_si256(_mm256_srli_epi32(w, 16), _mm256_set1_epi32(0x40));
+    __m256i isNan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    __m256i r = _mm256_blendv_epi8(rounded, quietNan, isNan);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                     _mm_packus_epi32(_mm256_castsi256_si128(r),
+                                      _mm256_extracti128_si256(r, 1)));
+}
+
+template <typename T>
+INFINI_TARGET_AVX2 void widenRowAVX2(const T *in, float *out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, widen8(in + i));
+    for (; i < n; ++i)
+        out[i] = toCompute(in[i]);
+}
+
+template <typename T>
+INFINI_TARGET_AVX2 void narrowRowAVX2(const float *in, T *out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        narrow8(out + i, _mm256_loadu_ps(in + i));
+    for (; i < n; ++i)
+        out[i] = fromCompute<T>(in[i]);
+}
+
+#endif // INFINI_SIMD_X86
+
+// Vector loops exist for Float32 and UInt32; other types use the generic one.
+template <typename T>
+constexpr bool hasSimdLoops =
+    std::is_same_v<T, float> || std::is_same_v<T, uint32_t>;
+
+// Conversions between a 16-bit storage type and float.
+template <typename T>
+using WidenRowFunc = void (*)(const T *in, float *out, size_t n);
+template <typename T>
+using NarrowRowFunc = void (*)(const float *in, T *out, size_t n);
+
+template <typename T> void widenRowGeneric(const T *in, float *out, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = toCompute(in[i]);
+}
+
+template <typename T>
+void narrowRowGeneric(const float *in, T *out, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = fromCompute<T>(in[i]);
+}
+
+template <typename T> WidenRowFunc<T> selectWidenRow(CpuIsa isa = getCpuIsa()) {
+#ifdef INFINI_SIMD_X86
+    if (isa >= CpuIsa::AVX2)
+        return widenRowAVX2<T>;
+#endif
+    return widenRowGeneric<T>;
+}
+
+template <typename T>
+NarrowRowFunc<T> selectNarrowRow(CpuIsa isa = getCpuIsa()) {
+#ifdef INFINI_SIMD_X86
+    if (isa >= CpuIsa::AVX2)
+        return narrowRowAVX2<T>;
+#endif
+    return narrowRowGeneric<T>;
+}
+
+template <typename T, typename Op>
+void binaryRowHalf(T *out, const T *a, const T *b, size_t n, size_t sa,
+                   size_t sb);
+template <typename T>
+void clampRowHalf(T *out, const T *in, size_t n, T lo, T hi);
+
+template <typename T, typename Op>
+BinaryRowFunc<T> selectBinaryRow(CpuIsa isa = getCpuIsa()) {
+    if constexpr (isHalfType<T>)
+        return binaryRowHalf<T, Op>;
+    else {
+#ifdef INFINI_SIMD_X86
+        if constexpr (hasSimdLoops<T>) {
+            if (isa >= CpuIsa::AVX512)
+                return binaryRowAVX512<T, Op>;
+            if (isa >= CpuIsa::AVX2)
+                return binaryRowAVX2<T, Op>;
+            if (isa >= CpuIsa::SSE42)
+                return binaryRowSSE42<T, Op>;
+        }
+#endif
+        return binaryRowGeneric<T, Op>;
+    }
+}
+
+template <typename T> ClampRowFunc<T> selectClampRow(CpuIsa isa = getCpuIsa()) {
+    if constexpr (isHalfType<T>)
+        return clampRowHalf<T>;
+    else {
+#ifdef INFINI_SIMD_X86
+        if constexpr (hasSimdLoops<T>) {
+            if (isa >= CpuIsa::AVX512)
+                return clampRowAVX512<T>;
+            if (isa >= CpuIsa::AVX2)
+                return clampRowAVX2<T>;
+            if (isa >= CpuIsa::SSE42)
+                return clampRowSSE42<T>;
+        }
+#endif
+        return clampRowGeneric<T>;
+    }
+}
+
+// 16-bit storage types are widened block by block into float, computed by
+// the float loops and narrowed back; the float copies only live in small
+// stack buffers that stay in L1.
+constexpr size_t HALF_BLOCK = 256;
+
+template <typename T, typename Op>
+void binaryRowHalf(T *out, const T *a, const T *b, size_t n, size_t sa,
+                   size_t sb) {
+    static const auto widen = selectWidenRow<T>();
+    static const auto narrow = selectNarrowRow<T>();
+    static const auto row = selectBinaryRow<float, Op>();
+    float fa[HALF_BLOCK], fb[HALF_BLOCK], fout[HALF_BLOCK];
+    for (size_t i = 0; i < n; i += HALF_BLOCK) {
+        size_t len = std::min(HALF_BLOCK, n - i);
+        widen(a + i * sa, fa, sa ? len : 1);
+        widen(b + i * sb, fb, sb ? len : 1);
+        row(fout, fa, fb, len, sa, sb);
+        narrow(fout, out + i, len);
+    }
+}
+
+template <typename T>
+void clampRowHalf(T *out, const T *in, size_t n, T lo, T hi) {
+    static const auto widen = selectWidenRow<T>();
+    static const auto narrow = selectNarrowRow<T>();
+    static const auto clamp = selectClampRow<float>();
+    float buf[HALF_BLOCK];
+    for (size_t i = 0; i < n; i += HALF_BLOCK) {
+        size_t len = std::min(HALF_BLOCK, n - i);
+        widen(in + i, buf, len);
+        clamp(buf, buf, len, toCompute(lo), toCompute(hi));
+        narrow(buf, out + i, len);
+    }
+}
+
+// out[i] = relu(in[i]) = max(in[i], 0), where NaN maps to 0 as MaxOp keeps
+// the second operand. The Relu kernel, FusedElementWise and the MatMul
+// epilogue all run this one loop.
+template <typename T> void reluRow(T *out, const T *in, size_t n) {
+    static const auto max = selectBinaryRow<T, MaxOp>();
+    const T zero{};
+    max(out, in, &zero, n, 1, 0);
+}
+
+using CopyFunc = void (*)(void *dst, const void *src, size_t bytes);
+
+inline void plainCopy(void *dst, const void *src, size_t bytes) {
+    std::memcpy(dst, src, bytes);
+}
+
+// Non-temporal copy when the CPU has one, memcpy otherwise.
+inline CopyFunc selectStreamCopy(CpuIsa isa = getCpuIsa()) {
+#ifdef INFINI_SIMD_X86
+    if (isa >= CpuIsa::AVX2)
+        return streamCopyAVX2;
+    if (isa >= CpuIsa::SSE42)
+        return streamCopySSE42;
+#endif
+    return plainCopy;
+}
+
+} // namespace infini
+
+#endif
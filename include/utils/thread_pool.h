@@ -0,0 +1,115 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace infini {
+
+// Persistent work-stealing thread pool shared by the runtime and the CPU
+// kernels. Every worker owns a deque of tasks: it pushes and pops its own
+// tasks at the back and steals from the front of the others when it runs
+// dry. The ranges of a parallelFor() are kept apart from the tasks: idle
+// workers pick them up before any task, and the thread that forked the loop
+// runs its remaining ranges itself and nothing else, so a kernel waiting
+// for its loop never runs an unrelated task nested on its stack.
+class ThreadPool {
+  public:
+    using Task = std::function<void()>;
+
+    // "numThreads" counts the calling thread, which joins in while it waits,
+    // so numThreads - 1 workers are started.
+    explicit ThreadPool(size_t numThreads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // The pool of the process. Its size is OMP_NUM_THREADS if set, else the
+    // number of hardware threads.
+    static ThreadPool &getInstance();
+
+    size_t size() const { return workers.size() + 1; }
+
+    // Queue a task: on the deque of the calling worker, or round-robin when
+    // called from outside the pool.
+    void submit(Task task);
+
+    // Run pending loop ranges and tasks until "done" returns true. Not to
+    // be called from inside a task, which would nest the tasks it runs.
+    void waitUntil(const std::function<bool()> &done);
+
+    // Split [0, n) into ranges, run "body" on each of them across the pool
+    // and return when all are done. The calling thread takes ranges until
+    // none is left, then waits for those other threads are running.
+    void parallelFor(size_t n,
+                     const std::function<void(size_t, size_t)> &body);
+
+    // How many parallelFor() calls of the calling thread had a range run by
+    // another thread. Comparing it before and after some code tells whether
+    // that code's work stayed on the calling thread.
+    static size_t sharedLoops();
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // A running parallelFor(). Ranges are claimed through "next"; "left"
+    // counts those not finished yet.
+    struct Loop {
+        const std::function<void(size_t, size_t)> *body;
+        size_t n, nRanges;
+        std::atomic<size_t> next{0}, left{0};
+        std::atomic<bool> shared{false};
+
+        void run(size_t r) const {
+            (*body)(n * r / nRanges, n * (r + 1) / nRanges);
+        }
+    };
+
+    // Pop a task of the calling thread's own deque, or steal one, and run
+    // it. Returns false if every deque was empty.
+    bool runOne();
+    // Claim a range of a running loop and run it. Returns false if no loop
+    // had one left.
+    bool helpLoop();
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending{0}, nextQueue{0};
+    // loops with ranges left to claim, guarded by "loopMutex"
+    std::mutex loopMutex;
+    std::vector<Loop *> loops;
+    std::atomic<size_t> openLoops{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stop = false;
+};
+
+// Run body(i) for every i in [0, n) on the shared pool, or inline when
+// "parallel" is false or there is nothing to split.
+template <typename F> void parallelFor(size_t n, F &&body, bool parallel) {
+    if (!parallel || n < 2) {
+        for (size_t i = 0; i < n; ++i)
+            body(i);
+        return;
+    }
+    ThreadPool::getInstance().parallelFor(n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            body(i);
+    });
+}
+
+} // namespace infini
+
+#endif
@@ -29,36 +29,22 @@ size_t Allocator::alloc(size_t size) {
   // TODO: 设计一个算法来分配内存，返回起始地址偏移量
   // =================================== 作业
   // ===================================
-  // 1. 如果free_blocks为空，则直接分配内存
-  if (free_blocks.empty()) {
-    size_t offset = used;
-    used += size;
-    peak = std::max(peak, used);
-    return offset;
-  }
-
-  // 2. 从free_blocks中找到一个合适的block
-  for (auto it = free_blocks.begin(); it != free_blocks.end(); ++it) {
-    if (it->second >= size) {
-      // 找到大小足够的空闲块
-      size_t offset = it->first;
-      size_t blockSize = it->second;
-
-      // 从free_blocks中移除这个块
-      free_blocks.erase(it);
-
-      // 如果剩余空间足够大,将其加入free_blocks
-      if (blockSize > size) {
-        free_blocks[offset + size] = blockSize - size;
-      }
-
-      used += size;
-      peak = std::max(peak, used);
-      return offset;
+  // 1. 最佳适配：在按 (大小, 地址) 排序的 free_by_size 中找最小的足够大的
+  // 空闲块，大小相同时取地址最低的
+  auto fit = free_by_size.lower_bound({size, 0});
+  if (fit != free_by_size.end()) {
+    auto [blockSize, offset] = *fit;
+    eraseFreeBlock(free_blocks.find(offset));
+
+    // 剩余部分仍作为空闲块
+    if (blockSize > size) {
+      insertFreeBlock(offset + size, blockSize - size);
     }
+    return offset;
   }
 
-  // 3. 找不到合适的block,分配新内存
+  // 2. 找不到合适的block,在已用区域的末尾分配新内存。free() 会把紧贴
+  // used 的空闲块还给末尾，所以这里从末尾增长即是扩展那个空闲块
   size_t offset = used;
   used += size;
   peak = std::max(peak, used);
@@ -74,41 +60,46 @@ void Allocator::free(size_t addr, size_t size) {
 
   // =================================== 作业
   // ===================================
-  // 1. 减少已使用的内存大小
-  used -= size;
-
-  // 2. 将要释放的内存块加入free_blocks
-  free_blocks[addr] = size;
-
-  // 3. 尝试合并相邻的空闲块
-  auto it = free_blocks.find(addr);
-
-  // 向前合并
-  if (it != free_blocks.begin()) {
-    auto prev = std::prev(it);
+  // 1. 与相邻的空闲块合并
+  auto next = free_blocks.lower_bound(addr);
+  if (next != free_blocks.begin()) {
+    auto prev = std::prev(next);
     if (prev->first + prev->second == addr) {
       // 前一个块的结尾地址等于当前块的起始地址,可以合并
-      prev->second += it->second;
-      free_blocks.erase(it);
-      it = prev;
+      addr = prev->first;
+      size += prev->second;
+      eraseFreeBlock(prev);
     }
   }
+  if (next != free_blocks.end() && addr + size == next->first) {
+    // 当前块的结尾地址等于后一个块的起始地址,可以合并
+    size += next->second;
+    eraseFreeBlock(next);
+  }
 
-  // 向后合并
-  auto next = std::next(it);
-  if (next != free_blocks.end()) {
-    if (it->first + it->second == next->first) {
-      // 当前块的结尾地址等于后一个块的起始地址,可以合并
-      it->second += next->second;
-      free_blocks.erase(next);
-    }
+  // 2. 如果空闲块位于已用区域的末尾,直接收缩已用区域
+  if (addr + size == used) {
+    used = addr;
+    return;
   }
+  insertFreeBlock(addr, size);
+}
+
+void Allocator::insertFreeBlock(size_t addr, size_t size) {
+  free_blocks.emplace(addr, size);
+  free_by_size.emplace(size, addr);
+}
+
+void Allocator::eraseFreeBlock(std::map<size_t, size_t>::iterator it) {
+  free_by_size.erase({it->second, it->first});
+  free_blocks.erase(it);
 }
 
 void *Allocator::getPtr() {
   if (this->ptr == nullptr) {
     this->ptr = runtime->alloc(this->peak);
-    printf("Allocator really alloc: %p %lu bytes\n", this->ptr, peak);
+    std::cout << "Allocator really alloc: " << this->ptr << " " << peak
+              << " bytes" << std::endl;
   }
   return this->ptr;
 }
@@ -1,16 +1,20 @@
 #include "core/graph.h"
-#include "operators/matmul.h"
-#include "operators/transpose.h"
+#include "core/tracer.h"
 #include <algorithm>
+#include <deque>
+#include <map>
 #include <numeric>
 #include <optional>
 #include <queue>
+#include <set>
 
 namespace infini {
 
 void GraphObj::addOperatorAndConnect(const Operator &op) {
   sorted = false;
+  compiled = false;
   ops.push_back(op);
+  indexOperators(ops.size() - 1);
   for (auto &input : op->getInputs()) {
     if (input) {
       input->addTarget(op);
@@ -29,9 +33,65 @@ void GraphObj::addOperatorAndConnect(const Operator &op) {
       }
     }
   }
+  touch(op);
+}
+
+void GraphObj::removeOperator(Operator op) {
+  compiled = false;
+  auto it = op ? opIndex.find(op->getGuid()) : opIndex.end();
+  if (it == opIndex.end())
+    return;
+  // 只留下空位，其他算子的位置不变
+  ops[it->second] = nullptr;
+  opIndex.erase(it);
+  ++deadOps;
+}
+
+void GraphObj::removeTensor(Tensor tensor) {
+  compiled = false;
+  auto it = tensor ? tensorIndex.find(tensor->getGuid()) : tensorIndex.end();
+  if (it == tensorIndex.end())
+    return;
+  auto fuid = fuidIndex.find(tensor->getFuid());
+  if (fuid != fuidIndex.end() && fuid->second == it->second)
+    fuidIndex.erase(fuid);
+  tensors[it->second] = nullptr;
+  tensorIndex.erase(it);
+  ++deadTensors;
+}
+
+void GraphObj::compact() const {
+  if (deadOps > 0) {
+    ops.erase(std::remove(ops.begin(), ops.end(), nullptr), ops.end());
+    opIndex.clear();
+    indexOperators();
+    deadOps = 0;
+  }
+  if (deadTensors > 0) {
+    tensors.erase(std::remove(tensors.begin(), tensors.end(), nullptr),
+                  tensors.end());
+    tensorIndex.clear();
+    fuidIndex.clear();
+    indexTensors();
+    deadTensors = 0;
+  }
+}
+
+void GraphObj::indexOperators(size_t from) const {
+  for (size_t i = from; i < ops.size(); ++i)
+    opIndex[ops[i]->getGuid()] = i;
+}
+
+void GraphObj::indexTensors(size_t from) const {
+  for (size_t i = from; i < tensors.size(); ++i) {
+    tensorIndex[tensors[i]->getGuid()] = i;
+    // 同一 FUID 只记录第一个张量，checkValid() 会报告重复
+    fuidIndex.emplace(tensors[i]->getFuid(), i);
+  }
 }
 
 string GraphObj::toString() const {
+  compact();
   std::ostringstream oss;
   oss << "Graph Tensors:\n";
   for (const auto &tensor : tensors)
@@ -53,37 +113,333 @@ string GraphObj::toString() const {
 }
 
 bool GraphObj::topo_sort() {
+  compact();
   if (this->sorted) {
     return true;
   }
-  std::vector<Operator> sorted;
-  std::unordered_set<OperatorObj *> flags;
-  sorted.reserve(ops.size());
-  flags.reserve(ops.size());
-  while (sorted.size() < ops.size()) {
-    auto modified = false;
-    auto const &op = ops[0];
-    auto const &inputs = op->getInputs();
-    for (auto const &op : ops) {
-      if (flags.find(op.get()) == flags.end() &&
-          std::all_of(inputs.begin(), inputs.end(),
-                      [&flags](auto const &input) {
-                        auto ptr = input->getSource().get();
-                        return !ptr || flags.find(ptr) != flags.end();
-                      })) {
-        modified = true;
-        sorted.emplace_back(op);
-        flags.insert(op.get());
-      }
+  return topo_sort(TopoSortPolicy::Stable);
+}
+
+bool GraphObj::topo_sort(TopoSortPolicy policy) {
+  // Kahn 算法：由后继关系统计每个算子的入度，每个算子和每条边只访问一次。
+  // 重复的边（同一张量被使用两次）在入度和后继中各计一次，因此保持一致
+  compact();
+  const size_t n = ops.size();
+  vector<vector<size_t>> succs(n);
+  vector<size_t> inDegree(n, 0);
+  for (size_t i = 0; i < n; ++i) {
+    for (auto &succ : ops[i]->getSuccessors()) {
+      auto it = opIndex.find(succ->getGuid());
+      if (it == opIndex.end())
+        continue;
+      succs[i].emplace_back(it->second);
+      ++inDegree[it->second];
     }
-    if (!modified) {
-      return false;
+  }
+
+  // Memory 策略的代价：输出占用的字节减去执行后即可释放的输入字节，
+  // 代价小的先执行；图的输入和输出常驻内存，不计入
+  vector<int64_t> cost;
+  if (policy == TopoSortPolicy::Memory) {
+    cost.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+      for (auto &output : ops[i]->getOutputs())
+        if (output && !output->getTargets().empty())
+          cost[i] += output->getBytes();
+      for (auto &input : ops[i]->getInputs())
+        if (input && input->getSource() && input->getTargets().size() == 1)
+          cost[i] -= input->getBytes();
     }
   }
+  auto later = [&cost](size_t a, size_t b) {
+    return cost[a] != cost[b] ? cost[a] > cost[b] : a > b;
+  };
+  std::priority_queue<size_t, vector<size_t>, decltype(later)> heap(later);
+
+  // 就绪集合：Stable 为队列，Locality 为栈，Memory 为按代价排序的堆
+  vector<size_t> ready;
+  size_t head = 0;
+  auto push = [&](size_t i) {
+    if (policy == TopoSortPolicy::Memory)
+      heap.push(i);
+    else
+      ready.emplace_back(i);
+  };
+  auto empty = [&]() {
+    if (policy == TopoSortPolicy::Memory)
+      return heap.empty();
+    return head == ready.size();
+  };
+  auto pop = [&]() {
+    size_t i;
+    if (policy == TopoSortPolicy::Memory) {
+      i = heap.top();
+      heap.pop();
+    } else if (policy == TopoSortPolicy::Locality) {
+      i = ready.back();
+      ready.pop_back();
+    } else {
+      i = ready[head++];
+    }
+    return i;
+  };
+  // 栈逆序压入，使下标小的算子先出栈
+  bool lifo = policy == TopoSortPolicy::Locality;
+  for (size_t k = 0; k < n; ++k) {
+    size_t i = lifo ? n - 1 - k : k;
+    if (inDegree[i] == 0)
+      push(i);
+  }
+
+  std::vector<Operator> sorted;
+  sorted.reserve(n);
+  while (!empty()) {
+    size_t i = pop();
+    sorted.emplace_back(ops[i]);
+    for (size_t k = 0; k < succs[i].size(); ++k) {
+      size_t s = lifo ? succs[i][succs[i].size() - 1 - k] : succs[i][k];
+      if (--inDegree[s] == 0)
+        push(s);
+    }
+  }
+  // 仍有算子未输出，说明图中存在环
+  if (sorted.size() < n) {
+    return false;
+  }
   this->ops = std::move(sorted);
+  indexOperators();
+  this->compiled = false;
   return this->sorted = true;
 }
 
+namespace {
+// dataMalloc() 眼中的内存占用模型：图的输入输出常驻，中间张量从生产者执行时
+// 分配，到最后一个使用者执行后释放，常量不占 arena
+struct LivenessModel {
+  size_t resident = 0;
+  vector<size_t> bytes;            // 中间张量的字节数（已对齐）
+  vector<size_t> outBytes;         // 每个算子产生的中间张量字节数
+  vector<vector<size_t>> reads;    // 每个算子读取的中间张量，重复读取计多次
+  vector<vector<size_t>> readers;  // 读取每个中间张量的算子，不重复
+  vector<vector<size_t>> succs;    // 每个算子的后继
+  vector<size_t> uses, inDegree;   // 剩余的读取次数和未执行的前驱数
+  size_t live = 0, peak = 0;
+
+  static size_t aligned(size_t size) {
+    constexpr size_t alignment = sizeof(uint64_t);
+    return (size + alignment - 1) / alignment * alignment;
+  }
+
+  // 执行第 i 个算子，返回执行前的峰值以便撤销
+  size_t apply(size_t i) {
+    size_t before = peak;
+    live += outBytes[i];
+    peak = std::max(peak, live);
+    for (auto t : reads[i])
+      if (--uses[t] == 0)
+        live -= bytes[t];
+    return before;
+  }
+  void undo(size_t i, size_t before) {
+    for (auto t : reads[i])
+      if (uses[t]++ == 0)
+        live += bytes[t];
+    live -= outBytes[i];
+    peak = before;
+  }
+  // 执行后活跃字节的变化量
+  int64_t delta(size_t i) const {
+    int64_t d = outBytes[i];
+    auto &r = reads[i];
+    for (auto it = r.begin(); it != r.end(); ++it) {
+      // 重复读取的张量只在第一次出现时计算
+      if (std::find(r.begin(), it, *it) != it)
+        continue;
+      if (uses[*it] == size_t(std::count(it, r.end(), *it)))
+        d -= bytes[*it];
+    }
+    return d;
+  }
+};
+} // namespace
+
+size_t GraphObj::estimatePeakMemory() {
+  IT_ASSERT(topo_sort() == true);
+  size_t resident = 0, live = 0, peak = 0;
+  std::unordered_map<TensorObj *, size_t> uses;
+  for (auto &tensor : tensors) {
+    if (tensor->isConstant())
+      continue;
+    if (!tensor->getSource() || tensor->getTargets().empty() ||
+        isDeclaredOutput(tensor))
+      resident += LivenessModel::aligned(tensor->getBytes());
+    else
+      uses[tensor.get()] = tensor->getTargets().size();
+  }
+  for (auto &op : ops) {
+    for (auto &output : op->getOutputs())
+      if (uses.count(output.get()))
+        live += LivenessModel::aligned(output->getBytes());
+    peak = std::max(peak, live);
+    for (auto &input : op->getInputs()) {
+      auto it = uses.find(input.get());
+      if (it != uses.end() && --it->second == 0)
+        live -= LivenessModel::aligned(input->getBytes());
+    }
+  }
+  return resident + peak;
+}
+
+size_t GraphObj::scheduleForMemory(size_t searchBudget) {
+  IT_ASSERT(topo_sort() == true);
+  const size_t n = ops.size();
+  LivenessModel m;
+  std::unordered_map<TensorObj *, size_t> transient;
+  for (auto &tensor : tensors) {
+    if (tensor->isConstant())
+      continue;
+    auto size = LivenessModel::aligned(tensor->getBytes());
+    if (!tensor->getSource() || tensor->getTargets().empty() ||
+        isDeclaredOutput(tensor)) {
+      m.resident += size;
+      continue;
+    }
+    transient[tensor.get()] = m.bytes.size();
+    m.bytes.emplace_back(size);
+    m.uses.emplace_back(tensor->getTargets().size());
+  }
+  m.outBytes.assign(n, 0);
+  m.reads.resize(n);
+  m.readers.resize(m.bytes.size());
+  size_t maxReads = 0;
+  m.succs.resize(n);
+  m.inDegree.assign(n, 0);
+  for (size_t i = 0; i < n; ++i) {
+    for (auto &output : ops[i]->getOutputs()) {
+      auto it = transient.find(output.get());
+      if (it != transient.end())
+        m.outBytes[i] += m.bytes[it->second];
+    }
+    for (auto &input : ops[i]->getInputs()) {
+      auto it = transient.find(input.get());
+      if (it == transient.end())
+        continue;
+      auto &readers = m.readers[it->second];
+      if (readers.empty() || readers.back() != i)
+        readers.emplace_back(i);
+      m.reads[i].emplace_back(it->second);
+      maxReads = std::max(maxReads, m.reads[i].size());
+    }
+    for (auto &succ : ops[i]->getSuccessors()) {
+      m.succs[i].emplace_back(opIndex.at(succ->getGuid()));
+      ++m.inDegree[m.succs[i].back()];
+    }
+  }
+
+  // 当前顺序作为初始的最优解
+  size_t best = estimatePeakMemory() - m.resident;
+  vector<size_t> bestOrder;
+
+  // 深度优先的分支限界：每层按活跃字节的增量从小到大尝试就绪算子，
+  // 第一条路径即是贪心解；峰值不小于最优解的分支被剪掉。用显式栈，
+  // 以免大图递归过深
+  //
+  // 就绪算子按 (增量, 下标) 存在有序集合里。增量只取决于所读张量的剩余
+  // 读取次数，且只在次数不超过算子自身的读取次数时才计入，所以只有次数
+  // 降到 maxReads 附近时才需要刷新读取该张量的就绪算子，每步不必重排整个
+  // 就绪集合
+  std::set<std::pair<int64_t, size_t>> ready;
+  vector<int64_t> key(n);
+  vector<bool> isReady(n, false);
+  auto enter = [&](size_t i) {
+    key[i] = m.delta(i);
+    ready.emplace(key[i], i);
+    isReady[i] = true;
+  };
+  auto leave = [&](size_t i) {
+    ready.erase({key[i], i});
+    isReady[i] = false;
+  };
+  // 第 i 个算子执行或撤销后，刷新增量可能变了的就绪算子
+  auto refresh = [&](size_t i) {
+    for (auto t : m.reads[i]) {
+      if (m.uses[t] > maxReads + m.reads[i].size())
+        continue;
+      for (auto j : m.readers[t])
+        if (isReady[j]) {
+          leave(j);
+          enter(j);
+        }
+    }
+  };
+  for (size_t i = 0; i < n; ++i)
+    if (m.inDegree[i] == 0)
+      enter(i);
+  vector<size_t> order, peaks;
+  auto apply = [&](size_t i) {
+    order.emplace_back(i);
+    leave(i);
+    peaks.emplace_back(m.apply(i));
+    refresh(i);
+    for (auto s : m.succs[i])
+      if (--m.inDegree[s] == 0)
+        enter(s);
+  };
+  auto undo = [&]() {
+    size_t i = order.back();
+    for (auto s : m.succs[i])
+      if (m.inDegree[s]++ == 0)
+        leave(s);
+    m.undo(i, peaks.back());
+    refresh(i);
+    enter(i);
+    order.pop_back();
+    peaks.pop_back();
+  };
+  // 撤销会把就绪集合恢复原样，所以每层只需记住上次尝试的键，下一个选择
+  // 就是集合中紧随其后的那个
+  struct Frame {
+    bool started = false;
+    std::pair<int64_t, size_t> last;
+  };
+  vector<Frame> frames(1);
+  size_t steps = 0, limit = n + searchBudget;
+  while (!frames.empty()) {
+    auto &frame = frames.back();
+    auto next = frame.started ? ready.upper_bound(frame.last) : ready.begin();
+    if (next == ready.end() || steps >= limit) {
+      frames.pop_back();
+      if (!order.empty())
+        undo();
+      continue;
+    }
+    frame.started = true;
+    frame.last = *next;
+    apply(next->second);
+    ++steps;
+    if (m.peak >= best) {
+      undo();
+    } else if (order.size() == n) {
+      best = m.peak;
+      bestOrder = order;
+      undo();
+    } else {
+      frames.emplace_back();
+    }
+  }
+
+  if (!bestOrder.empty()) {
+    OpVec scheduled;
+    scheduled.reserve(n);
+    for (auto i : bestOrder)
+      scheduled.emplace_back(ops[i]);
+    ops = std::move(scheduled);
+    indexOperators();
+    compiled = false;
+  }
+  return m.resident + best;
+}
+
 void GraphObj::optimize() {
   // =================================== 作业
   // ===================================
@@ -98,134 +454,298 @@ void GraphObj::optimize() {
   // 如果拓扑排序失败,直接返回
   if (!this->topo_sort())
     return;
-  bool optimized;
-  do {
-    optimized = false;
-
-    // 遍历所有算子
-    for (size_t i = 0; i < ops.size(); ++i) {
-      auto op = ops[i];
-      // 处理Transpose算子
-      if (op->getOpType() == OpType::Transpose) {
-        auto opd = as<TransposeObj>(op);
-        auto input = op->getInputs(0);
-        auto prevOp = input->getSource();
-
-        // 检查是否有两个相邻的Transpose算子
-        if (prevOp && prevOp->getOpType() == OpType::Transpose &&
-            input->getTargets().size() == 1) {
-          auto prevOpd = as<TransposeObj>(prevOp);
-          auto prevInput = prevOp->getInputs(0);
-
-          // 合并两个Transpose的置换操作
-          auto perm = opd->getPermute();
-          // 检查两个Transpose操作组合后是否为恒等变换
-          // 通过将两个置换操作组合，并检查结果是否为[0,1,2,...]来判断
-          bool isIdentity = true;
-          for (size_t j = 0; j < perm.size(); ++j) {
-            // 组合两个置换操作:先做prevOpd的置换,再做当前op的置换
-            perm[j] = prevOpd->getPermute()[perm[j]];
-            // 如果最终结果中任何位置不等于其下标,说明不是恒等变换
-            if (perm[j] != int(j)) {
-              isIdentity = false;
-            }
-          }
-
-          // 更新连接关系
-          prevInput->removeTarget(prevOp);
-          if (isIdentity) {
-            // 如果合并后是恒等变换,直接删除两个Transpose
-            for (auto succ : op->getSuccessors()) {
-              succ->replaceInput(op->getOutput(), prevInput);
-              prevInput->addTarget(succ);
-            }
-            this->removeTensor(op->getOutput());
-          }
-
-          // 清理旧的连接关系
-          for (auto pred : prevOp->getPredecessors())
-            pred->removeSuccessors(prevOp);
-          for (auto succ : op->getSuccessors())
-            succ->removePredecessors(op);
-
-          // 删除旧的Tensor和Operator
-          removeTensor(input);
-          removeOperator(op);
-          removeOperator(prevOp);
-          optimized = true;
-          i -= 2;
-          break;
-        }
-      }
+  eliminateDeadCode();
+  eliminateCommonSubexpressions();
+  foldConstants();
+  RewritePatternSet patterns;
+  populateTransposePatterns(patterns);
+  applyPatterns(patterns);
+  // 下沉 Transpose 可能在常量上留下新的 Transpose
+  foldConstants();
+  // 融合放在最后，以免挡住 Transpose 的下沉；MatMul 的尾声先于逐元素融合，
+  // 以免 MatMul 之后的 Add、Relu、Clip 先被合并成 FusedElementWise
+  RewritePatternSet epilogue;
+  populateEpiloguePatterns(epilogue);
+  applyPatterns(epilogue);
+  RewritePatternSet fusion;
+  populateFusionPatterns(fusion);
+  applyPatterns(fusion);
+  // 图已定型，最后挑选峰值内存最小的执行顺序
+  scheduleForMemory();
+}
 
-      // 处理MatMul算子
-      if (op->getOpType() == OpType::MatMul) {
-        auto matmulOp = as<MatmulObj>(op);
-
-        // 检查MatMul的输入是否有Transpose
-        for (int inputIdx = 0; inputIdx < 2; ++inputIdx) {
-          auto input = op->getInputs(inputIdx);
-          auto transposeOp = input->getSource();
-
-          // 如果输入来自Transpose且只有这一个目标
-          if (transposeOp && transposeOp->getOpType() == OpType::Transpose &&
-              input->getTargets().size() == 1) {
-            auto transposeObj =
-                as<TransposeObj>(transposeOp);
-            auto perm = transposeObj->getPermute();
-
-            // 检查是否只交换了最后两个维度
-            bool isLastTwoSwapped =
-                (perm.size() > 1 &&
-                 perm[perm.size() - 2] == int(perm.size() - 1) &&
-                 perm[perm.size() - 1] == int(perm.size() - 2));
-            bool isIdentityElsewhere = true;
-            for (size_t j = 0; j < perm.size() - 2; ++j) {
-              if (perm[j] != int(j)) {
-                isIdentityElsewhere = false;
-                break;
-              }
-            }
-            if (!isLastTwoSwapped || !isIdentityElsewhere) {
-              continue;
-            }
-
-            // 将Transpose融入到MatMul的属性中
-            if (inputIdx == 0) {
-              matmulOp->setTransA(!matmulOp->getTransA());
-            } else {
-              matmulOp->setTransB(!matmulOp->getTransB());
-            }
-
-            // 更新连接关系
-            auto prevInput = transposeOp->getInputs(0);
-            prevInput->removeTarget(transposeOp);
-            prevInput->addTarget(matmulOp);
-            matmulOp->replaceInput(input, prevInput);
-            matmulOp->removePredecessors(transposeOp);
-
-            // 删除Transpose
-            this->removeTensor(input);
-            this->removeOperator(transposeOp);
-            optimized = true;
-            break;
-          }
-        }
+size_t GraphObj::foldConstants() {
+  if (!topo_sort())
+    return 0;
+  const auto &kernelRegistry = KernelRegistry::getInstance();
+  size_t folded = 0;
+  // 按拓扑序一次扫描即可：折叠后的输出成为常量，后继算子随之可以折叠
+  for (auto op : OpVec(ops)) {
+    bool foldable = !op->getInputs().empty();
+    for (auto &input : op->getInputs())
+      foldable &= input && input->isConstant();
+    for (auto &output : op->getOutputs())
+      foldable &= !output->getTargets().empty();
+    if (!foldable)
+      continue;
+    for (auto &output : op->getOutputs())
+      output->setConstant();
+    auto kernelAttrs =
+        KernelAttrs{runtime->getDevice(), op->getOpType().underlying()};
+    kernelRegistry.getKernel(kernelAttrs)->compute(op, runtime.get());
+    // 输出保留为没有来源的常量；不再被使用的常量输入随算子一并删除
+    eraseOperator(op, true);
+    ++folded;
+  }
+  return folded;
+}
+
+size_t GraphObj::eliminateCommonSubexpressions() {
+  if (!topo_sort())
+    return 0;
+  // 以 (OpType, 属性, 输入 FUID) 的哈希分桶，桶内再逐个比较
+  std::unordered_map<size_t, OpVec> buckets;
+  auto keyOf = [](const Operator &op) {
+    auto attrs = op->getOpAttrVector();
+    size_t h = attrs.size();
+    auto mix = [&h](size_t v) {
+      h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    };
+    for (auto a : attrs)
+      mix(std::hash<int>()(a));
+    for (auto &input : op->getInputs())
+      mix(std::hash<UidBaseType>()(input->getFuid()));
+    return h;
+  };
+  size_t removed = 0;
+  // 按拓扑序扫描：合并后使用者读到同一个张量，随后也能被合并
+  for (auto op : OpVec(ops)) {
+    auto &bucket = buckets[keyOf(op)];
+    auto attrs = op->getOpAttrVector();
+    Operator same;
+    for (auto &other : bucket)
+      if (other->getInputs() == op->getInputs() &&
+          other->getOpAttrVector() == attrs) {
+        same = other;
+        break;
       }
+    bool keep = !same;
+    for (auto &output : op->getOutputs())
+      keep |= output->getTargets().empty() || isDeclaredOutput(output);
+    if (keep) {
+      bucket.emplace_back(op);
+      continue;
     }
-  } while (optimized); // 如果有优化发生就继续循环
+    for (size_t i = 0; i < op->getOutputs().size(); ++i)
+      replaceAllUses(op->getOutput(i), same->getOutput(i));
+    eraseOperator(op);
+    ++removed;
+  }
+  return removed;
 }
 
-Tensor GraphObj::getTensor(int fuid) const {
-  for (auto tensor : tensors) {
-    if (tensor->getFuid() == fuid) {
-      return tensor;
+size_t GraphObj::eliminateDeadCode() {
+  if (declaredOutputs.empty() || !topo_sort())
+    return 0;
+  // 从声明的输出沿来源反向标记仍被需要的算子
+  std::unordered_set<UidBaseType> live;
+  OpVec stack;
+  auto visit = [&](const Tensor &tensor) {
+    auto source = tensor->getSource();
+    if (source && live.insert(source->getGuid()).second)
+      stack.emplace_back(source);
+  };
+  for (auto &output : declaredOutputs)
+    if (hasTensor(output))
+      visit(output);
+  while (!stack.empty()) {
+    auto op = stack.back();
+    stack.pop_back();
+    for (auto &input : op->getInputs())
+      visit(input);
+  }
+  // 逆拓扑序删除，删除时其输出的使用者都已删除
+  size_t removed = 0;
+  for (auto it = ops.rbegin(); it != ops.rend(); ++it) {
+    auto op = *it;
+    if (!op || live.count(op->getGuid()))
+      continue;
+    eraseOperator(op);
+    ++removed;
+  }
+  return removed;
+}
+
+size_t GraphObj::applyPatterns(const RewritePatternSet &patterns) {
+  compact();
+  // 工作队列：初始按当前顺序放入全部算子，每个算子在队列中至多出现一次
+  std::deque<Operator> worklist(ops.begin(), ops.end());
+  std::unordered_set<UidBaseType> queued;
+  for (auto &op : ops)
+    queued.insert(op->getGuid());
+
+  size_t rewrites = 0;
+  while (!worklist.empty()) {
+    auto op = worklist.front();
+    worklist.pop_front();
+    queued.erase(op->getGuid());
+    if (!hasOperator(op))
+      continue;
+    for (auto &pattern : patterns.get(op->getOpType())) {
+      touched.clear();
+      rewriting = true;
+      bool changed = pattern.apply(*this, op);
+      rewriting = false;
+      if (!changed)
+        continue;
+      // 只重新检查改写涉及的算子及其邻居，根算子本身总会再检查一次
+      ++rewrites;
+      touched.emplace_back(op);
+      for (auto &t : touched)
+        if (hasOperator(t) && queued.insert(t->getGuid()).second)
+          worklist.emplace_back(t);
+      break;
+    }
+  }
+  touched.clear();
+  return rewrites;
+}
+
+void GraphObj::touch(const Operator &op) {
+  if (!rewriting || !op)
+    return;
+  touched.emplace_back(op);
+  for (auto &pred : op->getPredecessors())
+    touched.emplace_back(pred);
+  for (auto &succ : op->getSuccessors())
+    touched.emplace_back(succ);
+}
+
+void GraphObj::relink(const Operator &op) {
+  for (auto &pred : op->getPredecessors())
+    pred->removeSuccessors(op);
+  op->predecessors.clear();
+  // 与 addOperatorAndConnect 一致：每次使用记录一条边
+  for (auto &input : op->getInputs()) {
+    if (!input)
+      continue;
+    if (auto pred = input->getSource()) {
+      pred->addSuccessors(op);
+      op->addPredecessors(pred);
+    }
+  }
+}
+
+Operator GraphObj::cloneOperator(const Operator &op, const TensorVec &inputs) {
+  auto shapes = op->inferShape(inputs);
+  IT_ASSERT(shapes.has_value());
+  auto dtypes = op->inferDataType(inputs);
+  // inferShape 可能缓存与输入有关的属性（如 MatMul 的 m、n、k），恢复原值
+  op->inferShape(op->getInputs());
+  TensorVec outputs;
+  for (size_t i = 0; i < shapes->size(); ++i)
+    outputs.emplace_back(addTensor((*shapes)[i], dtypes[i]));
+  auto clone = op->clone(inputs, outputs);
+  addOperatorAndConnect(clone);
+  return clone;
+}
+
+void GraphObj::replaceInput(const Operator &op, const Tensor &from,
+                            const Tensor &to) {
+  if (from == to)
+    return;
+  sorted = false;
+  compiled = false;
+  touch(op);
+  op->replaceInput(from, to);
+  from->removeTarget(op);
+  to->removeTarget(op);
+  for (auto &input : op->getInputs())
+    if (input == to)
+      to->addTarget(op);
+  relink(op);
+  touch(op);
+}
+
+void GraphObj::replaceAllUses(const Tensor &from, const Tensor &to) {
+  for (auto &target : from->getTargets())
+    replaceInput(target, from, to);
+}
+
+void GraphObj::replaceOutput(const Operator &op, const Tensor &from,
+                             const Tensor &to) {
+  IT_ASSERT(from->getTargets().empty() && !to->getSource());
+  IT_ASSERT(from->getDims() == to->getDims() &&
+            from->getDType() == to->getDType());
+  sorted = false;
+  compiled = false;
+  for (auto &output : op->outputs)
+    if (output == from)
+      output = to;
+  to->setSource(op);
+  for (auto &succ : to->getTargets()) {
+    succ->addPredecessors(op);
+    op->addSuccessors(succ);
+  }
+  removeTensor(from);
+  touch(op);
+}
+
+void GraphObj::eraseOperator(const Operator &op, bool keepOutputs) {
+  touch(op);
+  for (auto &input : op->getInputs())
+    if (input)
+      input->removeTarget(op);
+  for (auto &pred : op->getPredecessors())
+    pred->removeSuccessors(op);
+  for (auto &succ : op->getSuccessors())
+    succ->removePredecessors(op);
+  op->predecessors.clear();
+  op->successors.clear();
+  for (auto &output : op->getOutputs()) {
+    if (!output)
+      continue;
+    output->setSource(nullptr);
+    if (!keepOutputs) {
+      IT_ASSERT(output->getTargets().empty(),
+                "Erasing an operator whose output is still used");
+      removeTensor(output);
     }
   }
-  return nullptr;
+  // 不再被任何算子使用的图输入也一并删除
+  for (auto &input : op->getInputs())
+    if (input && !input->getSource() && input->getTargets().empty())
+      removeTensor(input);
+  removeOperator(op);
+}
+
+Tensor GraphObj::getTensor(int fuid) const {
+  auto it = fuidIndex.find(fuid);
+  return it == fuidIndex.end() ? nullptr : tensors[it->second];
+}
+
+Operator GraphObj::getOperator(UidBaseType guid) const {
+  auto it = opIndex.find(guid);
+  return it == opIndex.end() ? nullptr : ops[it->second];
+}
+
+bool GraphObj::hasTensor(const Tensor &tensor) const {
+  if (!tensor)
+    return false;
+  auto it = tensorIndex.find(tensor->getGuid());
+  return it != tensorIndex.end() && tensors[it->second] == tensor;
+}
+
+bool GraphObj::hasOperator(const Operator &op) const {
+  if (!op)
+    return false;
+  auto it = opIndex.find(op->getGuid());
+  return it != opIndex.end() && ops[it->second] == op;
 }
 
 void GraphObj::shape_infer() {
+  compact();
+  compiled = false;
   for (auto &op : ops) {
     auto ans = op->inferShape();
     IT_ASSERT(ans.has_value());
@@ -245,55 +765,175 @@ void GraphObj::shape_infer() {
 }
 
 // 运行时的图内存分配
-// 1. 为所有输入tensor分配内存
-// 2. 按拓扑顺序为算子的输出tensor分配内存
-// 3. 获取实际分配的内存指针并绑定到tensor
-// 4. 打印内存分配信息
-// 图的抽象：输入，张量，算子
+// 1. 根据拓扑序计算每个tensor的生命周期:由产生它的算子开始,到最后一个使用它的算子结束
+// 2. 图的输入和输出tensor在整个运行期间都保持有效,最先分配且不释放
+// 3. 按拓扑顺序为算子的输出tensor分配内存,并在最后一个使用者执行后释放中间tensor,
+//    使后续算子的输出可以复用这部分内存
+// 4. 获取实际分配的内存指针并绑定到tensor
+// 5. 打印内存分配信息
 void GraphObj::dataMalloc() {
   // topological sorting first
   IT_ASSERT(topo_sort() == true);
+  compiled = false;
   // =================================== 作业
   // ===================================
   // TODO：利用 allocator 给计算图分配内存
   // HINT: 获取分配好的内存指针后，可以调用 tensor 的 setDataBlob 函数给 tensor
   // 绑定内存
   // =================================== 作业
-  // =================================== 为每个tensor分配内存
-  std::unordered_map<int, size_t> tensorOffsets; // 记录每个tensor的内存偏移量
+  // ===================================
+  std::cout << "Estimated peak memory: " << estimatePeakMemory() << std::endl;
+  std::unordered_map<TensorObj *, size_t> tensorOffsets; // 记录每个tensor的内存偏移量
+  std::unordered_map<OperatorObj *, size_t> opIndex;
+  for (size_t i = 0; i < ops.size(); ++i)
+    opIndex[ops[i].get()] = i;
+
+  // 记录 arena 的分配和释放到时间线
+  auto tracer = runtime->getTracer();
+  size_t inUse = 0;
+  auto alloc = [&](const Tensor &tensor) {
+    auto offset = allocator.alloc(tensor->getBytes());
+    tensorOffsets[tensor.get()] = offset;
+    if (tracer)
+      tracer->recordMemory(tensor, offset, false, inUse += tensor->getBytes());
+  };
+  auto release = [&](const Tensor &tensor) {
+    auto offset = tensorOffsets.at(tensor.get());
+    allocator.free(offset, tensor->getBytes());
+    if (tracer)
+      tracer->recordMemory(tensor, offset, true, inUse -= tensor->getBytes());
+  };
 
-  // 1. 为所有输入tensor分配内存
+  // 1. 为图的输入和输出tensor分配常驻内存,并记录中间tensor的最后使用位置
+  vector<TensorVec> lastUsers(ops.size());
   for (auto &tensor : tensors) {
-    size_t bytes = tensor->getBytes();
-    size_t offset = allocator.alloc(bytes);
-    tensorOffsets[tensor->getFuid()] = offset;
+    // 常量自带存储，不占用 arena
+    if (tensor->isConstant())
+      continue;
+    auto targets = tensor->getTargets();
+    if (!tensor->getSource() || targets.empty() || isDeclaredOutput(tensor)) {
+      alloc(tensor);
+      continue;
+    }
+    size_t lastUse = 0;
+    for (auto &target : targets)
+      lastUse = std::max(lastUse, opIndex.at(target.get()));
+    lastUsers[lastUse].emplace_back(tensor);
   }
-  // 2. 按拓扑顺序为算子的输出tensor分配内存
-  for (auto &op : ops) {
-    for (auto &output : op->getOutputs()) {
-      size_t bytes = output->getBytes();
-      size_t offset = allocator.alloc(bytes);
-      tensorOffsets[output->getFuid()] = offset;
+
+  // 2. 按拓扑顺序为中间tensor分配内存,并在最后一个使用者之后释放
+  for (size_t i = 0; i < ops.size(); ++i) {
+    for (auto &output : ops[i]->getOutputs()) {
+      if (tensorOffsets.find(output.get()) == tensorOffsets.end())
+        alloc(output);
     }
+    for (auto &tensor : lastUsers[i])
+      release(tensor);
   }
+
   // 3. 获取实际分配的内存指针并绑定到tensor
-  void *basePtr = allocator.getPtr();
+  char *basePtr = static_cast<char *>(allocator.getPtr());
   for (auto &tensor : tensors) {
-    auto fuid = tensor->getFuid();
-    if (tensorOffsets.find(fuid) != tensorOffsets.end()) {
-      size_t offset = tensorOffsets[fuid];
-      char *tensorPtr = static_cast<char *>(basePtr) + offset;
-      auto blob = make_ref<BlobObj>(runtime, tensorPtr);
-      tensor->setDataBlob(blob);
-    }
+    if (tensor->isConstant())
+      continue;
+    auto blob =
+        make_ref<BlobObj>(runtime, basePtr + tensorOffsets.at(tensor.get()));
+    tensor->setDataBlob(blob);
   }
 
   allocator.info();
 }
 
+void GraphObj::compile() {
+  IT_ASSERT(topo_sort() == true);
+  const auto &kernelRegistry = KernelRegistry::getInstance();
+  plan.clear();
+  plan.reserve(ops.size());
+  for (auto &op : ops) {
+    auto kernelAttrs =
+        KernelAttrs{runtime->getDevice(), op->getOpType().underlying()};
+    Kernel *kernel = kernelRegistry.getKernel(kernelAttrs);
+    plan.push_back({op, kernel, kernel->prepare(op, runtime.get()), {}, 0});
+  }
+
+  // 数据依赖：生产者先于使用者
+  const size_t n = plan.size();
+  vector<vector<size_t>> succs(n);
+  for (size_t i = 0; i < n; ++i)
+    for (auto &succ : ops[i]->getSuccessors())
+      succs[i].emplace_back(opIndex.at(succ->getGuid()));
+
+  // 内存复用带来的依赖：dataMalloc 让生命期不相交的张量共用内存，后一个
+  // 张量的生产者必须等前一个张量的生产者和使用者都执行完
+  struct Span {
+    const char *begin, *end;
+    Tensor tensor;
+    size_t first, last;
+  };
+  vector<Span> spans;
+  for (auto &tensor : tensors) {
+    if (tensor->getBytes() == 0)
+      continue;
+    auto begin = tensor->getRawDataPtr<char *>();
+    size_t first = 0, last = 0;
+    if (auto source = tensor->getSource())
+      first = last = opIndex.at(source->getGuid());
+    for (auto &target : tensor->getTargets())
+      last = std::max(last, opIndex.at(target->getGuid()));
+    spans.push_back({begin, begin + tensor->getBytes(), tensor, first, last});
+  }
+  // 按生命期开始的先后扫描，只记录每段内存最近的占用者：每段内存的相邻
+  // 两任占用者之间连边，更早的占用者经由这些边传递地排在前面，所以边数
+  // 与张量数成线性，而不必两两比较所有重叠的张量
+  std::stable_sort(spans.begin(), spans.end(),
+                   [](const Span &a, const Span &b) {
+                     return a.first < b.first ||
+                            (a.first == b.first && !a.tensor->getSource() &&
+                             b.tensor->getSource());
+                   });
+  // 起始地址 -> (结束地址, 占用者在 spans 中的下标)，区间互不相交
+  std::map<const char *, std::pair<const char *, size_t>> tenants;
+  for (size_t i = 0; i < spans.size(); ++i) {
+    auto &late = spans[i];
+    auto it = tenants.upper_bound(late.begin);
+    if (it != tenants.begin() && std::prev(it)->second.first > late.begin)
+      --it;
+    while (it != tenants.end() && it->first < late.end) {
+      auto [begin, tenant] = *it;
+      auto [end, index] = tenant;
+      auto &early = spans[index];
+      auto source = late.tensor->getSource();
+      if (early.last < late.first && source) {
+        size_t to = opIndex.at(source->getGuid());
+        if (auto from = early.tensor->getSource())
+          succs[opIndex.at(from->getGuid())].emplace_back(to);
+        for (auto &target : early.tensor->getTargets())
+          succs[opIndex.at(target->getGuid())].emplace_back(to);
+      }
+      // 未被覆盖的两端仍归原占用者
+      it = tenants.erase(it);
+      if (begin < late.begin)
+        tenants.emplace(begin, std::make_pair(late.begin, index));
+      if (end > late.end)
+        tenants.emplace(late.end, std::make_pair(end, index));
+    }
+    tenants.emplace(late.begin, std::make_pair(late.end, i));
+  }
+  for (size_t i = 0; i < n; ++i) {
+    auto &s = succs[i];
+    std::sort(s.begin(), s.end());
+    s.erase(std::unique(s.begin(), s.end()), s.end());
+    for (auto j : s)
+      ++plan[j].numPredecessors;
+    plan[i].successors = std::move(s);
+  }
+  compiled = true;
+}
+
 Tensor GraphObj::addTensor(Shape dim, DataType dtype) {
   auto tensor = make_ref<TensorObj>(dim, dtype, runtime);
   tensors.push_back(tensor);
+  indexTensors(tensors.size() - 1);
   return tensor;
 }
 
@@ -303,6 +943,7 @@ Tensor GraphObj::addTensor(const Tensor &tensor) {
                 tensor->getRuntime()->toString() + " to " +
                 runtime->toString());
   tensors.emplace_back(tensor);
+  indexTensors(tensors.size() - 1);
   return tensor;
 }
 
@@ -317,32 +958,31 @@ TensorVec GraphObj::addTensor(const TensorVec &tensors) {
 // "inputs" or "outputs" of operators must be in "tensors"
 // "predecessors" and "successors" of an operator of "ops" must be in "ops".
 bool GraphObj::checkValid() const {
+  compact();
   for (auto tensor : tensors) {
     IT_ASSERT(
         !(tensor->getTargets().size() == 0 && nullptr == tensor->getSource()));
     for (auto op : tensor->getTargets()) {
-      IT_ASSERT(std::find(ops.begin(), ops.end(), op) != ops.end());
+      IT_ASSERT(hasOperator(op));
     }
     auto op = tensor->getSource();
-    IT_ASSERT(!(op && std::find(ops.begin(), ops.end(), op) == ops.end()));
+    IT_ASSERT(!(op && !hasOperator(op)));
   }
   for (auto op : ops) {
     for (auto tensor : op->getInputs()) {
-      IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) !=
-                tensors.end());
+      IT_ASSERT(hasTensor(tensor));
     }
     for (auto tensor : op->getOutputs()) {
-      IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) !=
-                tensors.end());
+      IT_ASSERT(hasTensor(tensor));
     }
     for (auto pre : op->getPredecessors()) {
-      IT_ASSERT(std::find(ops.begin(), ops.end(), pre) != ops.end());
+      IT_ASSERT(hasOperator(pre));
     }
     for (auto suc : op->getSuccessors()) {
-      IT_ASSERT(std::find(ops.begin(), ops.end(), suc) != ops.end());
+      IT_ASSERT(hasOperator(suc));
     }
   }
-  std::set<UidBaseType> s;
+  std::unordered_set<UidBaseType> s;
   // check whether two tensors with the same FUID exist
   for (auto tensor : tensors) {
     int cnt = s.count(tensor->getFuid());
@@ -71,6 +71,16 @@ namespace infini
 
     optional<vector<Shape>> OperatorObj::inferShape() { return inferShape(inputs); }
 
+    OpCost OperatorObj::getCost() const
+    {
+        OpCost cost;
+        for (auto &tensor : inputs)
+            cost.bytes += tensor->getBytes();
+        for (auto &tensor : outputs)
+            cost.bytes += tensor->getBytes();
+        return cost;
+    }
+
     vector<DataType> OperatorObj::inferDataType(const TensorVec &inputs) const
     {
         auto dataType = inputs[0]->getDType();
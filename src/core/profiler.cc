@@ -0,0 +1,212 @@
+#include "core/profiler.h"
+#include "core/runtime.h"
+#include "operators/matmul.h"
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+
+namespace infini
+{
+
+    namespace
+    {
+        // 重复多次取最快的一次，排除首次运行和调度的干扰
+        template <typename F>
+        double bestSeconds(int repeat, F &&f)
+        {
+            double best = 1e30;
+            for (int i = 0; i < repeat; ++i)
+            {
+                auto start = std::chrono::steady_clock::now();
+                f();
+                std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - start;
+                best = std::min(best, elapsed.count());
+            }
+            return best;
+        }
+
+        MachinePeak measurePeak()
+        {
+            MachinePeak peak;
+            {
+                const int n = 256;
+                Runtime runtime = NativeCpuRuntimeObj::getInstance();
+                Graph g = make_ref<GraphObj>(runtime);
+                auto a = g->addTensor({n, n}, DataType::Float32);
+                auto b = g->addTensor({n, n}, DataType::Float32);
+                g->addOp<MatmulObj>(a, b, nullptr);
+                g->dataMalloc();
+                g->compile();
+                auto &func = g->getPlan()[0].func;
+                double seconds = bestSeconds(5, func);
+                peak.gflops = 2. * n * n * n / seconds * 1e-9;
+            }
+            {
+                const size_t bytes = 64 << 20;
+                vector<char> src(bytes, 1), dst(bytes, 0);
+                double seconds = bestSeconds(
+                    3, [&]()
+                    { std::memcpy(dst.data(), src.data(), bytes); });
+                peak.gbps = 2. * bytes / seconds * 1e-9;
+            }
+            return peak;
+        }
+    } // namespace
+
+    const MachinePeak &MachinePeak::measure()
+    {
+        static const MachinePeak peak = measurePeak();
+        return peak;
+    }
+
+    void ProfilerObj::record(const Instruction &instr, double seconds,
+                             const PerfSample &events, bool partial)
+    {
+        auto cost = instr.op->getCost();
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [it, inserted] = rowOf.emplace(instr.kernel, records.size());
+        if (inserted)
+        {
+            auto opType = instr.op->getOpType();
+            auto &registry = KernelRegistry::getInstance();
+            auto &item = registry.getKernelItem(
+                KernelAttrs{instr.op->getOutput()->getRuntime()->getDevice(),
+                            opType.underlying()});
+            records.push_back({opType, std::get<1>(item)});
+        }
+        auto &r = records[it->second];
+        ++r.calls;
+        r.seconds += seconds;
+        r.flops += cost.flops;
+        r.bytes += cost.bytes;
+        bool counted = false;
+        for (size_t i = 0; i < NUM_PERF_EVENTS; ++i)
+        {
+            if (!events.valid[i])
+                continue;
+            r.events[i] += events.values[i];
+            ++r.eventCalls[i];
+            counted = true;
+        }
+        r.partialCalls += counted && partial;
+    }
+
+    void ProfilerObj::reset()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rowOf.clear();
+        records.clear();
+    }
+
+    vector<ProfilerObj::Record> ProfilerObj::getRecords() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto ret = records;
+        std::stable_sort(ret.begin(), ret.end(),
+                         [](const Record &a, const Record &b)
+                         { return a.seconds > b.seconds; });
+        return ret;
+    }
+
+    void ProfilerObj::reportCounters(std::ostream &oss,
+                                     const vector<Record> &rows) const
+    {
+        bool any = false;
+        for (auto &r : rows)
+            for (auto n : r.eventCalls)
+                any |= n > 0;
+        if (!any)
+        {
+            oss << "Hardware counters unavailable\n";
+            return;
+        }
+        // 每种缺失事件一列，按每 KB 访存量计
+        const std::pair<PerfEvent, const char *> misses[] = {
+            {PerfEvent::LLCMisses, "LLC miss/KB"},
+            {PerfEvent::DTLBMisses, "dTLB miss/KB"},
+            {PerfEvent::BranchMisses, "branch miss/KB"}};
+        oss << std::left << std::setw(28) << "Kernel" << std::right
+            << std::setw(7) << "Calls" << std::setw(8) << "IPC";
+        for (auto &[event, name] : misses)
+            oss << std::setw(16) << name;
+        oss << "\n";
+        auto cycles = size_t(PerfEvent::Cycles),
+             instructions = size_t(PerfEvent::Instructions);
+        bool anyPartial = false;
+        for (auto &r : rows)
+        {
+            // 部分工作在其他线程上完成的算子，计数只覆盖调用线程，用 * 标出
+            anyPartial |= r.partialCalls > 0;
+            oss << std::left << std::setw(28)
+                << (r.partialCalls ? r.kernel + "*" : r.kernel) << std::right
+                << std::setw(7) << r.calls << std::setw(8);
+            // 计数缺失的事件显示 n/a
+            if (r.eventCalls[cycles] && r.eventCalls[instructions] &&
+                r.events[cycles] > 0)
+                oss << r.events[instructions] / r.events[cycles];
+            else
+                oss << "n/a";
+            for (auto &[event, name] : misses)
+            {
+                auto i = size_t(event);
+                oss << std::setw(16);
+                if (r.eventCalls[i] && r.bytes > 0)
+                    oss << r.events[i] / r.bytes * 1024;
+                else
+                    oss << "n/a";
+            }
+            oss << "\n";
+        }
+        if (anyPartial)
+            oss << "* partial: part of the work ran on other threads, whose "
+                   "events are not counted\n";
+    }
+
+    string ProfilerObj::report()
+    {
+        if (!peak)
+            peak = MachinePeak::measure();
+        auto rows = getRecords();
+        double total = 0;
+        for (auto &r : rows)
+            total += r.seconds;
+        // 屋顶线模型：算术强度高于脊点 (峰值算力 / 峰值带宽) 的受算力限制，
+        // 否则受带宽限制，可达的上限取两者中较小的一个
+        double ridge = peak->gflops / peak->gbps;
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2);
+        oss << "Peak " << peak->gflops << " GFLOP/s, " << peak->gbps
+            << " GB/s, ridge " << ridge << " FLOP/B\n";
+        oss << std::left << std::setw(28) << "Kernel" << std::setw(18)
+            << "OpType" << std::right << std::setw(7) << "Calls"
+            << std::setw(11) << "Time(ms)" << std::setw(8) << "Time%"
+            << std::setw(10) << "GFLOP/s" << std::setw(9) << "GB/s"
+            << std::setw(9) << "FLOP/B" << std::setw(9) << "Bound"
+            << std::setw(8) << "Roof%" << "\n";
+        for (auto &r : rows)
+        {
+            // 时钟精度不足或空算子时耗时可能为零
+            double gflops = r.seconds > 0 ? r.flops / r.seconds * 1e-9 : 0;
+            double gbps = r.seconds > 0 ? r.bytes / r.seconds * 1e-9 : 0;
+            double intensity = r.bytes > 0 ? r.flops / r.bytes : 0;
+            bool computeBound = intensity >= ridge;
+            // 受带宽限制时按达到的带宽计，不做计算的算子（如 Transpose）也适用
+            double roof = computeBound ? gflops / peak->gflops
+                                       : gbps / peak->gbps;
+            oss << std::left << std::setw(28) << r.kernel << std::setw(18)
+                << r.opType.toString() << std::right << std::setw(7)
+                << r.calls << std::setw(11) << r.seconds * 1e3 << std::setw(8)
+                << (total > 0 ? r.seconds / total * 100 : 0) << std::setw(10)
+                << gflops << std::setw(9) << gbps << std::setw(9)
+                << intensity << std::setw(9)
+                << (computeBound ? "compute" : "memory") << std::setw(8)
+                << roof * 100 << "\n";
+        }
+        oss << "Total " << total * 1e3 << " ms\n";
+        if (hardwareCounters)
+            reportCounters(oss, rows);
+        return oss.str();
+    }
+
+} // namespace infini
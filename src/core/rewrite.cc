@@ -0,0 +1,397 @@
+#include "core/rewrite.h"
+#include "core/graph.h"
+#include "operators/element_wise.h"
+#include "operators/fused_element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include <limits>
+
+namespace infini {
+
+RewritePatternSet &RewritePatternSet::add(OpType root, string name,
+                                          RewriteFunc apply) {
+  patterns[root.underlying()].push_back({std::move(name), std::move(apply)});
+  return *this;
+}
+
+const vector<RewritePattern> &RewritePatternSet::get(OpType root) const {
+  static const vector<RewritePattern> none;
+  auto it = patterns.find(root.underlying());
+  return it == patterns.end() ? none : it->second;
+}
+
+static bool isIdentity(const vector<int> &perm) {
+  for (size_t j = 0; j < perm.size(); ++j)
+    if (perm[j] != int(j))
+      return false;
+  return true;
+}
+
+static bool swapsLastTwo(const vector<int> &perm) {
+  int rank = perm.size();
+  if (rank < 2 || perm[rank - 2] != rank - 1 || perm[rank - 1] != rank - 2)
+    return false;
+  for (int j = 0; j < rank - 2; ++j)
+    if (perm[j] != j)
+      return false;
+  return true;
+}
+
+// 连续的两个 Transpose 合成一个：out[j] = mid[perm[j]] = in[prev[perm[j]]]。
+// 合成为恒等变换时，使用者直接读取第一个 Transpose 的输入；否则只有中间
+// 张量没有其他使用者时才合并，以免多做一次数据搬运。声明为图输出的张量
+// 不能删除
+static bool composeTransposes(GraphObj &graph, const Operator &op) {
+  auto input = op->getInputs(0);
+  auto prev = input->getSource();
+  if (!prev || prev->getOpType() != OpType::Transpose)
+    return false;
+  auto perm = as<TransposeObj>(op)->getPermute();
+  auto prevPerm = as<TransposeObj>(prev)->getPermute();
+  vector<int> composed(perm.size());
+  for (size_t j = 0; j < perm.size(); ++j)
+    composed[j] = prevPerm[perm[j]];
+  auto source = prev->getInputs(0);
+  auto output = op->getOutput();
+  bool keepOutput =
+      output->getTargets().empty() || graph.isDeclaredOutput(output);
+
+  if (isIdentity(composed) && !keepOutput) {
+    graph.replaceAllUses(output, source);
+    graph.eraseOperator(op);
+  } else if (isIdentity(composed)) {
+    // 输出要保留，改由产生原输入的算子直接写入它
+    auto producer = source->getSource();
+    if (!producer || input->getTargets().size() != 1 ||
+        source->getTargets().size() != 1 || graph.isDeclaredOutput(input) ||
+        graph.isDeclaredOutput(source))
+      return false;
+    graph.eraseOperator(op, true);
+    graph.eraseOperator(prev);
+    graph.replaceOutput(producer, source, output);
+    return true;
+  } else {
+    if (input->getTargets().size() != 1)
+      return false;
+    graph.eraseOperator(op, true);
+    graph.addOpWithOutputs<TransposeObj>(source, output, composed);
+  }
+  if (input->getTargets().empty() && !graph.isDeclaredOutput(input))
+    graph.eraseOperator(prev);
+  return true;
+}
+
+// Transpose(MatMul(A, B)) 只交换最后两维时等于 MatMul(B^T, A^T)
+static bool foldTransposeOfMatmul(GraphObj &graph, const Operator &op) {
+  auto input = op->getInputs(0);
+  auto matmul = as<MatmulObj>(input->getSource());
+  // 尾声不能随转置交换到另一侧
+  if (!matmul || !matmul->getEpilogue().empty() ||
+      input->getTargets().size() != 1 || graph.isDeclaredOutput(input) ||
+      !swapsLastTwo(as<TransposeObj>(op)->getPermute()))
+    return false;
+  auto a = matmul->getInputs(0), b = matmul->getInputs(1);
+  bool transA = matmul->getTransA(), transB = matmul->getTransB();
+  auto output = op->getOutput();
+  // 先接上新的 MatMul 再删除旧的，以免 A、B 作为图的输入被一并删除
+  graph.eraseOperator(op, true);
+  graph.addOpWithOutputs<MatmulObj>(b, a, output, !transB, !transA);
+  graph.eraseOperator(matmul);
+  return true;
+}
+
+// 把 Transpose 下沉到与布局无关的算子之后：U(T(x, p)) => T(U(x), p)，
+// 这样 Transpose 可以与后面的 Transpose 相遇并合并或抵消，或者融入 MatMul
+namespace {
+enum class Operand { Keep, Untranspose, Transpose };
+}
+
+static bool sinkTranspose(GraphObj &graph, const Operator &op) {
+  auto output = op->getOutput();
+  auto outDims = output->getDims();
+  int rank = outDims.size();
+  // 只下沉形状与输出相同、且只被 op 使用的 Transpose，
+  // 这样被下沉的总是主操作数，不会与广播操作数来回交换
+  vector<int> perm;
+  for (auto &input : op->getInputs()) {
+    auto source = input->getSource();
+    if (source && source->getOpType() == OpType::Transpose &&
+        input->getDims() == outDims && input->getTargets().size() == 1 &&
+        !graph.isDeclaredOutput(input)) {
+      perm = as<TransposeObj>(source)->getPermute();
+      break;
+    }
+  }
+  if (perm.empty())
+    return false;
+  // 变窄的 Cast 之后再搬运更省，变宽的则相反
+  if (op->getOpType() == OpType::Cast &&
+      output->getDType().getSize() > op->getInputs(0)->getDType().getSize())
+    return false;
+  vector<int> inverse(rank);
+  for (int j = 0; j < rank; ++j)
+    inverse[perm[j]] = j;
+
+  // 先确认所有操作数都能换回未转置的布局，再修改图
+  vector<Operand> actions;
+  vector<vector<int>> perms;
+  for (auto &input : op->getInputs()) {
+    auto source = input->getSource();
+    auto dims = input->getDims();
+    int r = dims.size();
+    if (source && source->getOpType() == OpType::Transpose &&
+        as<TransposeObj>(source)->getPermute() == perm &&
+        input->getTargets().size() == 1 && !graph.isDeclaredOutput(input)) {
+      actions.push_back(Operand::Untranspose);
+      perms.emplace_back();
+      continue;
+    }
+    // 广播操作数按 inverse 转置。秩较小时按尾部对齐、前面补 1，
+    // 要求尾部的维度换回后仍落在尾部
+    if (input->size() >= output->size())
+      return false;
+    bool ok = true;
+    vector<int> q(r);
+    for (int k = 0; k < r && ok; ++k) {
+      q[k] = inverse[rank - r + k] - (rank - r);
+      ok = q[k] >= 0;
+    }
+    bool allOnes = input->size() == 1;
+    if (!ok && !allOnes)
+      return false;
+    actions.push_back(allOnes || isIdentity(q) ? Operand::Keep
+                                               : Operand::Transpose);
+    perms.push_back(q);
+  }
+
+  TensorVec inputs;
+  OpVec sources;
+  for (size_t i = 0; i < actions.size(); ++i) {
+    auto input = op->getInputs(i);
+    if (actions[i] == Operand::Untranspose) {
+      sources.emplace_back(input->getSource());
+      inputs.emplace_back(input->getSource()->getInputs(0));
+    } else if (actions[i] == Operand::Transpose) {
+      inputs.emplace_back(
+          graph.addOp<TransposeObj>(input, nullptr, perms[i])->getOutput());
+    } else {
+      inputs.emplace_back(input);
+    }
+  }
+  auto sunk = graph.cloneOperator(op, inputs);
+  graph.eraseOperator(op, true);
+  graph.addOpWithOutputs<TransposeObj>(sunk->getOutput(), output, perm);
+  for (auto &source : sources)
+    if (graph.hasOperator(source) && source->getOutput()->getTargets().empty())
+      graph.eraseOperator(source);
+  return true;
+}
+
+// 只交换最后两个维度的 Transpose 可以融入 MatMul 的 transA/transB 属性
+static bool foldTransposeIntoMatmul(GraphObj &graph, const Operator &op) {
+  auto matmul = as<MatmulObj>(op);
+  // 按值复制 A、B，replaceInput 会改写 op 的输入列表；尾声的输入不参与
+  for (auto input : TensorVec{op->getInputs(0), op->getInputs(1)}) {
+    auto transpose = input->getSource();
+    if (!transpose || transpose->getOpType() != OpType::Transpose)
+      continue;
+    if (!swapsLastTwo(as<TransposeObj>(transpose)->getPermute()))
+      continue;
+
+    // A 和 B 可能是同一个张量，两边都要翻转
+    auto source = transpose->getInputs(0);
+    if (op->getInputs(0) == input)
+      matmul->setTransA(!matmul->getTransA());
+    if (op->getInputs(1) == input)
+      matmul->setTransB(!matmul->getTransB());
+    graph.replaceInput(op, input, source);
+    IT_ASSERT(op->checkValid(nullptr));
+    if (input->getTargets().empty() && !graph.isDeclaredOutput(input))
+      graph.eraseOperator(transpose);
+    return true;
+  }
+  return false;
+}
+
+void populateTransposePatterns(RewritePatternSet &patterns) {
+  patterns.add(OpType::Transpose, "ComposeTransposes", composeTransposes);
+  patterns.add(OpType::Transpose, "FoldTransposeOfMatmul",
+               foldTransposeOfMatmul);
+  patterns.add(OpType::MatMul, "FoldTransposeIntoMatmul",
+               foldTransposeIntoMatmul);
+  for (auto type : {OpType::Add, OpType::Sub, OpType::Mul, OpType::Div,
+                    OpType::Relu, OpType::Clip, OpType::Cast})
+    patterns.add(type, "SinkTranspose", sinkTranspose);
+}
+
+// 把 MatMul 输出唯一的使用者并入 MatMul 的尾声：偏置或残差 Add、Relu、Clip。
+// 只处理 Float32，16 位类型的逐步舍入留给逐元素融合
+static bool fuseMatmulEpilogue(GraphObj &graph, const Operator &op) {
+  auto matmul = as<MatmulObj>(op);
+  auto output = op->getOutput();
+  auto targets = output->getTargets();
+  if (!(output->getDType() == DataType::Float32) || targets.size() != 1 ||
+      graph.isDeclaredOutput(output))
+    return false;
+  auto consumer = targets[0];
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  auto epilogue = matmul->getEpilogue();
+  auto inputs = op->getInputs();
+  switch (consumer->getOpType().underlying()) {
+  case OpType::Add: {
+    auto other = consumer->getInputs(0) == output ? consumer->getInputs(1)
+                                                  : consumer->getInputs(0);
+    if (other == output || !(other->getDType() == DataType::Float32))
+      return false;
+    auto dims = other->getDims();
+    int n = output->getDims().back();
+    if (dims == output->getDims())
+      epilogue.push_back({MatmulEpilogue::Residual, 0.f, 0.f});
+    else if (!dims.empty() && dims.size() <= output->getRank() &&
+             dims.back() == n && other->size() == size_t(n))
+      epilogue.push_back({MatmulEpilogue::Bias, 0.f, 0.f});
+    else
+      return false;
+    inputs.emplace_back(other);
+    break;
+  }
+  case OpType::Relu:
+    epilogue.push_back({MatmulEpilogue::Relu, 0.f, 0.f});
+    break;
+  case OpType::Clip: {
+    auto clip = as<ClipObj>(consumer);
+    epilogue.push_back({MatmulEpilogue::Clip, clip->getMin().value_or(-inf),
+                        clip->getMax().value_or(inf)});
+    break;
+  }
+  default:
+    return false;
+  }
+  // 先接上新的 MatMul 再删除旧算子，以免只被它们使用的图输入被一并删除
+  auto fused = graph.addOp<MatmulObj>(inputs, nullptr, matmul->getTransA(),
+                                      matmul->getTransB(), epilogue);
+  auto result = consumer->getOutput();
+  graph.eraseOperator(consumer, true);
+  graph.eraseOperator(op);
+  graph.replaceOutput(fused, fused->getOutput(), result);
+  return true;
+}
+
+void populateEpiloguePatterns(RewritePatternSet &patterns) {
+  patterns.add(OpType::MatMul, "FuseMatmulEpilogue", fuseMatmulEpilogue);
+}
+
+static bool isFloating(DataType dtype) {
+  return dtype == DataType::Float32 || dtype == DataType::Float16 ||
+         dtype == DataType::BFloat16;
+}
+
+// 可融合算子的表达式：单个算子为一步，FusedElementWise 为其自身的各步
+static bool fusibleSteps(const Operator &op, vector<FusedStep> &steps) {
+  for (auto &tensor : op->getInputs())
+    if (!isFloating(tensor->getDType()))
+      return false;
+  auto dtype = op->getOutput()->getDType();
+  if (!isFloating(dtype))
+    return false;
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  switch (op->getOpType().underlying()) {
+  case OpType::FusedElementWise:
+    steps = as<FusedElementWiseObj>(op)->getSteps();
+    return true;
+  case OpType::Add:
+  case OpType::Sub:
+  case OpType::Mul:
+  case OpType::Div:
+    steps = {{op->getOpType(), 0, 1, 0.f, 0.f, dtype}};
+    return true;
+  case OpType::Relu:
+  case OpType::Cast:
+    steps = {{op->getOpType(), 0, 0, 0.f, 0.f, dtype}};
+    return true;
+  case OpType::Clip: {
+    auto clip = as<ClipObj>(op);
+    steps = {{OpType::Clip, 0, 0, clip->getMin().value_or(-inf),
+              clip->getMax().value_or(inf), dtype}};
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+// 把产生 op 某个输入的可融合算子并入 op。中间张量只被 op 使用、且形状与
+// op 的输出相同（不被广播，避免重复计算）且不是声明的图输出时才融合，融合后
+// 中间张量不再写回内存。
+// 值的编号为先输入后各步：生产者的各步在前，最后一步替代中间张量
+static bool fuseElementWise(GraphObj &graph, const Operator &op) {
+  vector<FusedStep> steps;
+  if (!fusibleSteps(op, steps))
+    return false;
+  auto output = op->getOutput();
+  for (auto &input : op->getInputs()) {
+    auto producer = input->getSource();
+    vector<FusedStep> producerSteps;
+    if (!producer || input->getDims() != output->getDims() ||
+        !fusibleSteps(producer, producerSteps))
+      continue;
+    bool onlyOp = !graph.isDeclaredOutput(input);
+    for (auto &target : input->getTargets())
+      onlyOp &= target == op;
+    if (!onlyOp)
+      continue;
+
+    // 合并后的输入：生产者的输入在前，去掉重复的张量
+    TensorVec inputs;
+    auto indexOf = [&inputs](const Tensor &t) {
+      auto it = std::find(inputs.begin(), inputs.end(), t);
+      if (it != inputs.end())
+        return int(it - inputs.begin());
+      inputs.emplace_back(t);
+      return int(inputs.size()) - 1;
+    };
+    vector<int> producerMap, consumerMap;
+    for (auto &t : producer->getInputs())
+      producerMap.emplace_back(indexOf(t));
+    for (auto &t : op->getInputs())
+      consumerMap.emplace_back(t == input ? -1 : indexOf(t));
+    int nIn = inputs.size(), nProducer = producerSteps.size();
+    int fused = nIn + nProducer - 1;
+
+    vector<FusedStep> merged;
+    auto remap = [&](int v, const vector<int> &map, int base) {
+      return v < int(map.size()) ? map[v] : base + v - int(map.size());
+    };
+    for (auto step : producerSteps) {
+      step.lhs = remap(step.lhs, producerMap, nIn);
+      step.rhs = remap(step.rhs, producerMap, nIn);
+      merged.emplace_back(step);
+    }
+    for (auto &v : consumerMap)
+      if (v < 0)
+        v = fused;
+    for (auto step : steps) {
+      step.lhs = remap(step.lhs, consumerMap, nIn + nProducer);
+      step.rhs = remap(step.rhs, consumerMap, nIn + nProducer);
+      merged.emplace_back(step);
+    }
+
+    // 先接上融合算子再删除旧算子，以免只被它们使用的图输入被一并删除
+    auto fusedOp = graph.addOp<FusedElementWiseObj>(inputs, nullptr, merged);
+    graph.eraseOperator(op, true);
+    graph.eraseOperator(producer);
+    graph.replaceOutput(fusedOp, fusedOp->getOutput(), output);
+    return true;
+  }
+  return false;
+}
+
+void populateFusionPatterns(RewritePatternSet &patterns) {
+  for (auto type : {OpType::Add, OpType::Sub, OpType::Mul, OpType::Div,
+                    OpType::Relu, OpType::Clip, OpType::Cast,
+                    OpType::FusedElementWise})
+    patterns.add(type, "FuseElementWise", fuseElementWise);
+}
+
+} // namespace infini
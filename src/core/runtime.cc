@@ -2,22 +2,95 @@
 #include "core/blob.h"
 #include "core/kernel.h"
 #include "core/graph.h"
-#include "core/kernel.h"
+#include "core/profiler.h"
+#include "core/tracer.h"
+#include "utils/thread_pool.h"
+#include <atomic>
 #include <chrono>
 #include <cstring>
 #include <memory>
 namespace infini
 {
+    // 当前线程上正在执行的步骤内嵌套运行的步骤所用的时间
+    static thread_local double nestedSeconds = 0;
+
     void NativeCpuRuntimeObj::run(const Graph &graph) const
     {
-        const auto &kernelRegistry = KernelRegistry::getInstance();
+        if (!graph->isCompiled())
+            graph->compile();
 
-        for (auto &op : graph->getOperators())
+        auto &plan = graph->getPlan();
+        auto execute = [this](const Instruction &instr)
+        {
+            if (!profiler && !tracer)
+                return instr.func();
+            // 硬件计数器只统计执行该算子的线程
+            bool counting = profiler && profiler->usesHardwareCounters();
+            PerfSample before;
+            size_t loops = ThreadPool::sharedLoops();
+            if (counting)
+                before = PerfCounters::forThisThread().read();
+            double outer = nestedSeconds;
+            nestedSeconds = 0;
+            auto start = std::chrono::steady_clock::now();
+            instr.func();
+            auto end = std::chrono::steady_clock::now();
+            PerfSample events;
+            if (counting)
+                events = PerfCounters::forThisThread().read() - before;
+            // 有循环分给了其他线程时，计数不完整
+            bool partial = ThreadPool::sharedLoops() != loops;
+            // 只记录独占时间：若有步骤嵌套在本步骤中运行，扣除其时间，
+            // 并丢弃同样混入了其事件的计数
+            double seconds = std::chrono::duration<double>(end - start).count();
+            double exclusive = seconds - nestedSeconds;
+            if (nestedSeconds > 0)
+                events = PerfSample();
+            nestedSeconds = outer + seconds;
+            if (profiler)
+                profiler->record(instr, exclusive, events, partial);
+            if (tracer)
+                tracer->recordOp(instr, start, end);
+        };
+        auto &pool = ThreadPool::getInstance();
+        if (!parallel || plan.size() < 2)
         {
-            auto kernelAttrs = KernelAttrs{device, op->getOpType().underlying()};
-            Kernel *kernel = kernelRegistry.getKernel(kernelAttrs);
-            kernel->compute(op, this);
+            for (auto &instr : plan)
+                execute(instr);
+            return;
         }
+
+        // 每个步骤记录尚未完成的前驱数，减到零即提交给线程池
+        const size_t n = plan.size();
+        auto waiting = std::make_unique<std::atomic<size_t>[]>(n);
+        std::atomic<size_t> done(0);
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        std::function<void(size_t)> step = [&](size_t i)
+        {
+            try
+            {
+                execute(plan[i]);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+            for (auto s : plan[i].successors)
+                if (waiting[s].fetch_sub(1) == 1)
+                    pool.submit([&step, s]() { step(s); });
+            done.fetch_add(1);
+        };
+        for (size_t i = 0; i < n; ++i)
+            waiting[i] = plan[i].numPredecessors;
+        for (size_t i = 0; i < n; ++i)
+            if (plan[i].numPredecessors == 0)
+                pool.submit([&step, i]() { step(i); });
+        pool.waitUntil([&]() { return done.load() == n; });
+        if (error)
+            std::rethrow_exception(error);
     }
 
     string NativeCpuRuntimeObj::toString() const { return "CPU Runtime"; }
@@ -22,7 +22,7 @@ namespace infini {
         string ret = "Tensor " + std::to_string(guid) + ", Fuid " +
                      std::to_string(fuid) + ", shape " + vecToString(shape) +
                      ", dtype " + dtype.toString() + ", " + runtime->toString() +
-                     ", " + ss.str() + "\n";
+                     ", " + ss.str() + (isConstant() ? ", constant" : "") + "\n";
         vector<UidBaseType> targetGuids;
         for (const auto &op : targets)
             targetGuids.emplace_back(op.lock()->getGuid());
@@ -113,4 +113,13 @@ void TensorObj::setData(
 
 void TensorObj::setDataBlob(const Blob &blob) { this->data = blob; }
 
+void TensorObj::setConstant() {
+    if (isConstant())
+        return;
+    auto rt = runtime;
+    void *ptr = runtime->alloc(getBytes());
+    constantData = std::shared_ptr<void>(ptr, [rt](void *p) { rt->dealloc(p); });
+    data = make_ref<BlobObj>(runtime, ptr);
+}
+
 }; // namespace infini
@@ -0,0 +1,110 @@
+#include "core/tracer.h"
+#include <fstream>
+#include <iomanip>
+
+namespace infini
+{
+
+    double TracerObj::microseconds(Clock::time_point t) const
+    {
+        return std::chrono::duration<double, std::micro>(t - origin).count();
+    }
+
+    int TracerObj::threadIndex(std::thread::id id)
+    {
+        auto it = std::find(threads.begin(), threads.end(), id);
+        if (it != threads.end())
+            return it - threads.begin();
+        threads.emplace_back(id);
+        return threads.size() - 1;
+    }
+
+    void TracerObj::recordOp(const Instruction &instr, Clock::time_point start,
+                             Clock::time_point end)
+    {
+        auto &op = instr.op;
+        auto &registry = KernelRegistry::getInstance();
+        auto &item = registry.getKernelItem(
+            KernelAttrs{op->getOutputs()[0]->getRuntime()->getDevice(),
+                        op->getOpType().underlying()});
+        std::ostringstream args;
+        args << "{\"guid\":" << op->getGuid()
+             << ",\"kernel\":" << jsonQuote(std::get<1>(item))
+             << ",\"inputs\":[";
+        for (size_t i = 0; i < op->getInputs().size(); ++i)
+            args << (i ? "," : "")
+                 << jsonQuote(vecToString(op->getInputs(i)->getDims()));
+        args << "]}";
+        Event event{'X', op->getOpType().toString(), "op", microseconds(start),
+                    microseconds(end) - microseconds(start), 0, args.str()};
+        std::lock_guard<std::mutex> lock(mutex);
+        event.thread = threadIndex(std::this_thread::get_id());
+        events.emplace_back(std::move(event));
+    }
+
+    void TracerObj::recordMemory(const Tensor &tensor, size_t offset,
+                                 bool release, size_t inUse)
+    {
+        auto now = microseconds(Clock::now());
+        std::ostringstream args;
+        args << "{\"fuid\":" << tensor->getFuid() << ",\"offset\":" << offset
+             << ",\"bytes\":" << tensor->getBytes() << "}";
+        std::lock_guard<std::mutex> lock(mutex);
+        int thread = threadIndex(std::this_thread::get_id());
+        events.push_back({'i', release ? "free" : "alloc", "memory", now, 0,
+                          thread, args.str()});
+        events.push_back({'C', "arena", "memory", now, 0, thread,
+                          "{\"bytes\":" + std::to_string(inUse) + "}"});
+    }
+
+    size_t TracerObj::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return events.size();
+    }
+
+    void TracerObj::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.clear();
+    }
+
+    string TracerObj::toJson() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(3);
+        oss << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        // 元数据事件为进程和线程命名
+        oss << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":0,\"tid\":0,"
+               "\"args\":{\"name\":\"InfiniTensor\"}}";
+        for (size_t t = 0; t < threads.size(); ++t)
+            oss << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,"
+                << "\"tid\":" << t << ",\"args\":{\"name\":\"thread " << t
+                << "\"}}";
+        for (auto &e : events)
+        {
+            oss << ",\n{\"ph\":\"" << e.phase
+                << "\",\"name\":" << jsonQuote(e.name)
+                << ",\"cat\":" << jsonQuote(e.category)
+                << ",\"ts\":" << e.timestamp;
+            if (e.phase == 'X')
+                oss << ",\"dur\":" << e.duration;
+            if (e.phase == 'i')
+                oss << ",\"s\":\"t\"";
+            oss << ",\"pid\":0,\"tid\":" << e.thread << ",\"args\":" << e.args
+                << "}";
+        }
+        oss << "\n]}\n";
+        return oss.str();
+    }
+
+    void TracerObj::save(const string &path) const
+    {
+        std::ofstream file(path);
+        IT_ASSERT(file.good(), "Cannot open " + path);
+        file << toJson();
+        IT_ASSERT(file.good(), "Cannot write " + path);
+    }
+
+} // namespace infini
@@ -0,0 +1,292 @@
+#include "core/kernel.h"
+#include "operators/unary.h"
+#include "utils/half.h"
+#include "utils/simd.h"
+#include "utils/thread_pool.h"
+#include <limits>
+
+namespace infini {
+
+namespace {
+
+// Below this many elements the kernel runs on the calling thread only.
+constexpr size_t PARALLEL_THRESHOLD = 1 << 15;
+// Number of elements handed to a thread at a time.
+constexpr size_t CHUNK_SIZE = 1 << 13;
+
+// Scalar conversion, the reference for the vector loops. Floating point
+// values are truncated toward zero; every conversion to an integer type
+// saturates at its range and NaN becomes 0.
+template <typename To, typename From> To castValue(From v) {
+    using L = std::numeric_limits<To>;
+    if constexpr (std::is_same_v<From, To>)
+        return v;
+    else if constexpr (std::is_same_v<From, fp16_t>)
+        return castValue<To>(fp16ToFloat(v));
+    else if constexpr (std::is_same_v<From, bf16_t>)
+        return castValue<To>(bf16ToFloat(v));
+    else if constexpr (std::is_same_v<To, fp16_t>)
+        return floatToFp16(float(v));
+    else if constexpr (std::is_same_v<To, bf16_t>)
+        return floatToBf16(float(v));
+    else if constexpr (std::is_floating_point_v<To>)
+        return To(v);
+    else if constexpr (std::is_floating_point_v<From>) {
+        if (std::isnan(v))
+            return 0;
+        if (v <= From(L::min()))
+            return L::min();
+        if (v >= From(L::max()))
+            return L::max();
+        return To(v);
+    } else {
+        if constexpr (std::is_signed_v<From>)
+            if (v < 0)
+                return int64_t(v) < int64_t(L::min()) ? L::min() : To(v);
+        return uint64_t(v) > uint64_t(L::max()) ? L::max() : To(v);
+    }
+}
+
+template <typename From, typename To>
+using CastRowFunc = void (*)(const From *in, To *out, size_t n);
+
+template <typename From, typename To>
+void castRowGeneric(const From *in, To *out, size_t n) {
+    if constexpr (std::is_same_v<From, To>)
+        std::memcpy(out, in, n * sizeof(To));
+    else
+        for (size_t i = 0; i < n; ++i)
+            out[i] = castValue<To>(in[i]);
+}
+
+#ifdef INFINI_SIMD_X86
+// Vector loops move 8 elements per step. load8 widens them to 32-bit lanes,
+// float for the floating point types and int32 for the integer ones, and
+// store8 narrows the lanes into the destination type, so each conversion is
+// one load8/store8 pair picked by overload resolution.
+
+// Zero-extended uint32 lanes, which must not be sign-extended to int64.
+struct U32x8 {
+    __m256i v;
+};
+
+INFINI_TARGET_AVX2 inline __m256 load8(const float *p) {
+    return _mm256_loadu_ps(p);
+}
+INFINI_TARGET_AVX2 inline __m256 load8(const fp16_t *p) { return widen8(p); }
+INFINI_TARGET_AVX2 inline __m256 load8(const bf16_t *p) { return widen8(p); }
+INFINI_TARGET_AVX2 inline __m256i load8(const int8_t *p) {
+    return _mm256_cvtepi8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+INFINI_TARGET_AVX2 inline __m256i load8(const uint8_t *p) {
+    return _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+INFINI_TARGET_AVX2 inline __m256i load8(const int16_t *p) {
+    return _mm256_cvtepi16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+INFINI_TARGET_AVX2 inline __m256i load8(const int32_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+INFINI_TARGET_AVX2 inline U32x8 load8(const uint32_t *p) {
+    return {_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))};
+}
+
+// Narrow int32 lanes with signed saturation.
+INFINI_TARGET_AVX2 inline __m128i packInt16(__m256i v) {
+    return _mm_packs_epi32(_mm256_castsi256_si128(v),
+                           _mm256_extracti128_si256(v, 1));
+}
+
+// NaN lanes become 0.
+INFINI_TARGET_AVX2 inline __m256 zeroNan(__m256 v) {
+    return _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+}
+
+INFINI_TARGET_AVX2 inline void store8(float *p, __m256 v) {
+    _mm256_storeu_ps(p, v);
+}
+INFINI_TARGET_AVX2 inline void store8(fp16_t *p, __m256 v) {
+    narrow8(p, v);
+}
+INFINI_TARGET_AVX2 inline void store8(bf16_t *p, __m256 v) {
+    narrow8(p, v);
+}
+// cvttps returns INT32_MIN for NaN and out of range lanes, which is already
+// the saturated value for negative overflow.
+INFINI_TARGET_AVX2 inline void store8(int32_t *p, __m256 v) {
+    v = zeroNan(v);
+    __m256i r = _mm256_cvttps_epi32(v);
+    __m256 over = _mm256_cmp_ps(v, _mm256_set1_ps(2147483648.f), _CMP_GE_OQ);
+    r = _mm256_blendv_epi8(r, _mm256_set1_epi32(INT32_MAX),
+                           _mm256_castps_si256(over));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), r);
+}
+INFINI_TARGET_AVX2 inline void store8(int16_t *p, __m256 v) {
+    v = _mm256_min_ps(_mm256_max_ps(zeroNan(v), _mm256_set1_ps(-32768.f)),
+                      _mm256_set1_ps(32767.f));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                     packInt16(_mm256_cvttps_epi32(v)));
+}
+INFINI_TARGET_AVX2 inline void store8(int8_t *p, __m256 v) {
+    v = _mm256_min_ps(_mm256_max_ps(zeroNan(v), _mm256_set1_ps(-128.f)),
+                      _mm256_set1_ps(127.f));
+    __m128i v16 = packInt16(_mm256_cvttps_epi32(v));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(p),
+                     _mm_packs_epi16(v16, v16));
+}
+
+INFINI_TARGET_AVX2 inline void store8(float *p, __m256i v) {
+    _mm256_storeu_ps(p, _mm256_cvtepi32_ps(v));
+}
+INFINI_TARGET_AVX2 inline void store8(int64_t *p, __m256i v) {
+    auto q = reinterpret_cast<__m256i *>(p);
+    _mm256_storeu_si256(q, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    _mm256_storeu_si256(q + 1,
+                        _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+}
+INFINI_TARGET_AVX2 inline void store8(int64_t *p, U32x8 v) {
+    auto q = reinterpret_cast<__m256i *>(p);
+    _mm256_storeu_si256(q, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v.v)));
+    _mm256_storeu_si256(
+        q + 1, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v.v, 1)));
+}
+INFINI_TARGET_AVX2 inline void store8(int32_t *p, __m256i v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+INFINI_TARGET_AVX2 inline void store8(int16_t *p, __m256i v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), packInt16(v));
+}
+INFINI_TARGET_AVX2 inline void store8(int8_t *p, __m256i v) {
+    __m128i v16 = packInt16(v);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(p),
+                     _mm_packs_epi16(v16, v16));
+}
+
+// AVX2 has no int64 <-> float conversions nor 64-bit saturating narrowing;
+// those use AVX-512 with 8 int64 lanes. The masked forms avoid GCC's
+// maybe-uninitialized warning on the pass-through operand.
+INFINI_TARGET_AVX512 inline __m512i load8(const int64_t *p) {
+    return _mm512_loadu_si512(p);
+}
+INFINI_TARGET_AVX512 inline void store8(int32_t *p, __m512i v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p),
+                        _mm512_maskz_cvtsepi64_epi32(0xFF, v));
+}
+INFINI_TARGET_AVX512 inline void store8(uint32_t *p, __m512i v) {
+    v = _mm512_maskz_max_epi64(0xFF, v, _mm512_setzero_si512());
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p),
+                        _mm512_maskz_cvtusepi64_epi32(0xFF, v));
+}
+INFINI_TARGET_AVX512 inline void store8(float *p, __m512i v) {
+    _mm256_storeu_ps(p, _mm512_maskz_cvtepi64_ps(0xFF, v));
+}
+INFINI_TARGET_AVX512 inline void store8(int64_t *p, __m256 v) {
+    v = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+    __m512i r = _mm512_maskz_cvttps_epi64(0xFF, v);
+    __mmask8 over = _mm256_cmp_ps_mask(
+        v, _mm256_set1_ps(9223372036854775808.f), _CMP_GE_OQ);
+    r = _mm512_mask_mov_epi64(r, over, _mm512_set1_epi64(INT64_MAX));
+    _mm512_storeu_si512(p, r);
+}
+
+template <typename From, typename To>
+constexpr bool needsAvx512 =
+    std::is_same_v<From, int64_t> ||
+    (std::is_same_v<From, float> && std::is_same_v<To, int64_t>);
+
+#define DEFINE_CAST_LOOP(ISA, TARGET)                                          \
+    template <typename From, typename To>                                      \
+    TARGET void castRow##ISA(const From *in, To *out, size_t n) {              \
+        size_t i = 0;                                                          \
+        for (; i + 8 <= n; i += 8)                                             \
+            store8(out + i, load8(in + i));                                    \
+        for (; i < n; ++i)                                                     \
+            out[i] = castValue<To>(in[i]);                                     \
+    }
+
+DEFINE_CAST_LOOP(AVX2, INFINI_TARGET_AVX2)
+DEFINE_CAST_LOOP(AVX512, INFINI_TARGET_AVX512)
+#undef DEFINE_CAST_LOOP
+#endif // INFINI_SIMD_X86
+
+template <typename From, typename To>
+CastRowFunc<From, To> selectCastRow(CpuIsa isa = getCpuIsa()) {
+#ifdef INFINI_SIMD_X86
+    if constexpr (!std::is_same_v<From, To>) {
+        if constexpr (needsAvx512<From, To>) {
+            if (isa >= CpuIsa::AVX512)
+                return castRowAVX512<From, To>;
+        } else if (isa >= CpuIsa::AVX2)
+            return castRowAVX2<From, To>;
+    }
+#endif
+    return castRowGeneric<From, To>;
+}
+
+} // namespace
+
+class NativeCast : public CpuKernelWithoutConfig {
+    template <typename From, typename To>
+    KernelFunc doPrepare(const Ref<CastObj> &op) const {
+        auto in = op->getInputs(0)->getRawDataPtr<From *>();
+        auto out = op->getOutput()->getRawDataPtr<To *>();
+        size_t size = op->getOutput()->size();
+        auto row = selectCastRow<From, To>();
+        return [=]() {
+            size_t nChunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            parallelFor(
+                nChunks,
+                [&](size_t c) {
+                    size_t start = c * CHUNK_SIZE;
+                    row(in + start, out + start,
+                        std::min(CHUNK_SIZE, size - start));
+                },
+                size >= PARALLEL_THRESHOLD);
+        };
+    }
+
+    KernelFunc prepare(const Operator &_op,
+                       const RuntimeObj *context) const override {
+        auto op = as<CastObj>(_op);
+#define CASE(TYPE, FROM, TO)                                                   \
+    case CastType::TYPE:                                                       \
+        return doPrepare<FROM, TO>(op)
+
+        switch (op->getType()) {
+            CASE(Float2Float16, float, fp16_t);
+            CASE(Float2Int64, float, int64_t);
+            CASE(Float2Int32, float, int32_t);
+            CASE(Float2Int16, float, int16_t);
+            CASE(Float2Int8, float, int8_t);
+            CASE(Float2BFloat16, float, bf16_t);
+            CASE(Int322Float, int32_t, float);
+            CASE(Int322Int8, int32_t, int8_t);
+            CASE(Int322Int16, int32_t, int16_t);
+            CASE(Int322Int64, int32_t, int64_t);
+            CASE(Int162Float, int16_t, float);
+            CASE(Int162Int32, int16_t, int32_t);
+            CASE(Int82Float, int8_t, float);
+            CASE(Int82Int16, int8_t, int16_t);
+            CASE(Int82Int32, int8_t, int32_t);
+            CASE(Uint82Float, uint8_t, float);
+            CASE(Uint82Int32, uint8_t, int32_t);
+            CASE(Uint82Int64, uint8_t, int64_t);
+            CASE(Int642Int32, int64_t, int32_t);
+            CASE(Int642Uint32, int64_t, uint32_t);
+            CASE(Int642Float, int64_t, float);
+            CASE(Uint322Int64, uint32_t, int64_t);
+            CASE(Float162Float, fp16_t, float);
+            CASE(BFloat162Float, bf16_t, float);
+            CASE(Float2Float, float, float);
+        default:
+            IT_TODO_HALT();
+        }
+    }
+};
+
+REGISTER_KERNEL(Device::CPU, OpType::Cast, NativeCast, "Cast_CPU");
+
+} // namespace infini
@@ -1,64 +1,84 @@
 #include "operators/concat.h"
 #include "core/kernel.h"
+#include "utils/simd.h"
+#include "utils/thread_pool.h"
 
 namespace infini {
 
-class NaiveConcat : public CpuKernelWithoutConfig {
-    template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+namespace {
+
+// Below this many output bytes the kernel runs on the calling thread only.
+constexpr size_t PARALLEL_THRESHOLD = 1 << 17;
+// Upper bound on the bytes copied by one memcpy, so that a few large blocks
+// still spread over every thread.
+constexpr size_t PIECE_SIZE = 1 << 15;
+
+// Part of one input block copied to every output row.
+struct ConcatPiece {
+    const char *src;
+    size_t srcRowStride, dstOffset, bytes;
+};
+
+} // namespace
+
+// The output is `outer` rows, each the concatenation of one contiguous block
+// of every input, so the kernel is one memcpy per outer index per input.
+class MemcpyConcat : public CpuKernelWithoutConfig {
+    KernelFunc prepare(const Operator &_op,
+                       const RuntimeObj *context) const override {
         auto op = as<ConcatObj>(_op);
-        auto inputs = op->getInputs(), outputs = op->getOutputs();
-        auto dim = op->getDim();
-        auto output = outputs[0];
-        std::vector<Shape> iDims;
-        for (auto input : inputs)
-            iDims.emplace_back(input->getDims());
+        auto output = op->getOutput();
+        int dim = op->getDim();
         const auto &outDim = output->getDims();
-        size_t blockOffsetInner = 1;
-        for (size_t i = outDim.size() - 1; i > (size_t)dim; --i)
-            blockOffsetInner *= outDim[i];
-        size_t blockOffset = outDim[dim] * blockOffsetInner;
-        for (size_t i = 0; i < inputs.size(); ++i) {
-            auto input = inputs[i];
-            auto dimOffset = 0;
-            auto iDim = iDims[i];
-            for (size_t j = 0; j < i; ++j)
-                dimOffset += iDims[j][dim];
-            size_t localBlockOffset = 1;
-            for (size_t i = iDim.size() - 1;
-                 i >= (size_t)dim && i != (size_t)-1; --i)
-                localBlockOffset *= iDim[i];
-            auto innerOffset = blockOffsetInner * dimOffset;
-            auto inSize = input->size();
-            auto inPtr = input->getRawDataPtr<T *>(),
-                 outPtr = output->getRawDataPtr<T *>();
-#pragma omp parallel for
-            for (size_t iOffset = 0; iOffset < inSize; ++iOffset) {
-                auto oOffset = iOffset % localBlockOffset + innerOffset +
-                               iOffset / localBlockOffset * blockOffset;
-                outPtr[oOffset] = inPtr[iOffset];
-            }
-        }
-    }
+        size_t elemSize = op->getDType().getSize();
+        size_t outer = 1, inner = elemSize;
+        for (int i = 0; i < dim; ++i)
+            outer *= outDim[i];
+        for (size_t i = dim + 1; i < outDim.size(); ++i)
+            inner *= outDim[i];
+        size_t rowBytes = outDim[dim] * inner;
+        size_t totalBytes = outer * rowBytes;
+        // An empty output has nothing to copy, and no row size to split by.
+        if (totalBytes == 0)
+            return []() {};
 
-    void compute(const Operator &_op,
-                 const RuntimeObj *context) const override {
-#define CASE(N)                                                                \
-    case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
-
-        int dataTypeIdx = _op->getDType().getIndex();
-        switch (dataTypeIdx) {
-            CASE(1); // DataType::Float32
-            break;
-            CASE(12); // DataType::UInt32
-            break;
-        default:
-            IT_TODO_HALT();
+        vector<ConcatPiece> pieces;
+        size_t dstOffset = 0;
+        for (auto input : op->getInputs()) {
+            size_t blockBytes = input->getDims()[dim] * inner;
+            auto src = input->getRawDataPtr<char *>();
+            for (size_t off = 0; off < blockBytes; off += PIECE_SIZE)
+                pieces.push_back({src + off, blockBytes, dstOffset + off,
+                                  std::min(PIECE_SIZE, blockBytes - off)});
+            dstOffset += blockBytes;
         }
+
+        bool parallel = totalBytes >= PARALLEL_THRESHOLD;
+        // Streaming stores only pay off once the output would evict the
+        // whole last level cache anyway.
+        CopyFunc copy = totalBytes > getLastLevelCacheSize()
+                            ? selectStreamCopy()
+                            : plainCopy;
+        size_t rowsPerItem = std::max<size_t>(1, PIECE_SIZE / rowBytes);
+        size_t nRowChunks = (outer + rowsPerItem - 1) / rowsPerItem;
+        auto dst = output->getRawDataPtr<char *>();
+        return [=]() {
+            size_t nPieces = pieces.size();
+            parallelFor(
+                nRowChunks * nPieces,
+                [&](size_t w) {
+                    const auto &piece = pieces[w % nPieces];
+                    size_t r0 = w / nPieces * rowsPerItem,
+                           r1 = std::min(outer, r0 + rowsPerItem);
+                    for (size_t r = r0; r < r1; ++r)
+                        copy(dst + r * rowBytes + piece.dstOffset,
+                             piece.src + r * piece.srcRowStride, piece.bytes);
+                },
+                parallel);
+        };
     }
 };
 
-REGISTER_KERNEL(Device::CPU, OpType::Concat, NaiveConcat, "ConcatNaive_CPU");
+REGISTER_KERNEL(Device::CPU, OpType::Concat, MemcpyConcat, "ConcatMemcpy_CPU");
 
 } // namespace infini
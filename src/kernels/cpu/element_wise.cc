@@ -1,37 +1,139 @@
 #include "operators/element_wise.h"
 #include "core/kernel.h"
 #include "utils/operator_utils.h"
+#include "utils/simd.h"
+#include "utils/thread_pool.h"
 
 namespace infini
 {
-    class NativeElementWise : public CpuKernelWithoutConfig
+    namespace
     {
-        template <typename T>
-        static T addCompute(T val0, T val1)
-        {
-            return val0 + val1;
-        }
+        // Below this many output elements the kernel runs on the calling
+        // thread only.
+        constexpr size_t PARALLEL_THRESHOLD = 1 << 15;
+        // Number of output elements handed to a thread at a time.
+        constexpr size_t CHUNK_SIZE = 1 << 13;
 
-        template <typename T>
-        static T subCompute(T val0, T val1)
+        /**
+         * @brief Broadcast layout of a binary element-wise op. Output dims of
+         * size 1 are dropped and adjacent dims are merged whenever every input
+         * either matches the output on both or is broadcast on both, so the
+         * common cases collapse to rank 1 (same shape, scalar) or rank 2
+         * (row/column broadcast). Strides are 0 on broadcast dims.
+         */
+        struct BroadcastLayout
         {
-            return val0 - val1;
-        }
+            vector<size_t> dims, strideA, strideB;
+        };
 
-        template <typename T>
-        static T mulCompute(T val0, T val1)
+        BroadcastLayout collapseBroadcast(const Shape &a, const Shape &b,
+                                          const Shape &c)
         {
-            return val0 * val1;
+            BroadcastLayout layout;
+            vector<bool> bcastA, bcastB;
+            for (size_t d = 0; d < c.size(); ++d)
+            {
+                if (c[d] == 1)
+                    continue;
+                bool ba = a[d] == 1, bb = b[d] == 1;
+                if (!layout.dims.empty() && ba == bcastA.back() &&
+                    bb == bcastB.back())
+                {
+                    layout.dims.back() *= c[d];
+                    continue;
+                }
+                layout.dims.emplace_back(c[d]);
+                bcastA.emplace_back(ba);
+                bcastB.emplace_back(bb);
+            }
+            if (layout.dims.empty())
+            {
+                layout.dims.emplace_back(1);
+                bcastA.emplace_back(false);
+                bcastB.emplace_back(false);
+            }
+            auto rank = layout.dims.size();
+            layout.strideA.resize(rank);
+            layout.strideB.resize(rank);
+            size_t sa = 1, sb = 1;
+            for (auto d = rank; d-- > 0;)
+            {
+                layout.strideA[d] = bcastA[d] ? 0 : sa;
+                layout.strideB[d] = bcastB[d] ? 0 : sb;
+                sa *= bcastA[d] ? 1 : layout.dims[d];
+                sb *= bcastB[d] ? 1 : layout.dims[d];
+            }
+            return layout;
         }
 
         template <typename T>
-        static T divCompute(T val0, T val1)
+        void applyBroadcast(const BroadcastLayout &layout, const T *a,
+                            const T *b, T *out, BinaryRowFunc<T> row)
         {
-            return (T)(val0 / val1);
+            auto rank = layout.dims.size();
+            size_t inner = layout.dims[rank - 1];
+            size_t sa = layout.strideA[rank - 1], sb = layout.strideB[rank - 1];
+            if (rank == 1)
+            {
+                // Same shape or scalar broadcast: split the flat range.
+                size_t nChunks = (inner + CHUNK_SIZE - 1) / CHUNK_SIZE;
+                parallelFor(
+                    nChunks,
+                    [&](size_t c)
+                    {
+                        size_t start = c * CHUNK_SIZE;
+                        row(out + start, a + start * sa, b + start * sb,
+                            std::min(CHUNK_SIZE, inner - start), sa, sb);
+                    },
+                    inner >= PARALLEL_THRESHOLD);
+                return;
+            }
+            // Walk the output row by row. Each chunk of rows locates its first
+            // row once and then advances the input offsets with counters.
+            size_t rows = 1;
+            for (size_t d = 0; d + 1 < rank; ++d)
+                rows *= layout.dims[d];
+            size_t rowsPerChunk = std::max<size_t>(1, CHUNK_SIZE / inner);
+            size_t nChunks = (rows + rowsPerChunk - 1) / rowsPerChunk;
+            parallelFor(
+                nChunks,
+                [&](size_t c)
+                {
+                    size_t r0 = c * rowsPerChunk,
+                           r1 = std::min(rows, r0 + rowsPerChunk);
+                    vector<size_t> idx(rank - 1);
+                    size_t offA = 0, offB = 0, rest = r0;
+                    for (auto d = rank - 1; d-- > 0;)
+                    {
+                        idx[d] = rest % layout.dims[d];
+                        rest /= layout.dims[d];
+                        offA += idx[d] * layout.strideA[d];
+                        offB += idx[d] * layout.strideB[d];
+                    }
+                    for (size_t r = r0; r < r1; ++r)
+                    {
+                        row(out + r * inner, a + offA, b + offB, inner, sa, sb);
+                        for (auto d = rank - 1; d-- > 0;)
+                        {
+                            offA += layout.strideA[d];
+                            offB += layout.strideB[d];
+                            if (++idx[d] < layout.dims[d])
+                                break;
+                            offA -= layout.strideA[d] * layout.dims[d];
+                            offB -= layout.strideB[d] * layout.dims[d];
+                            idx[d] = 0;
+                        }
+                    }
+                },
+                rows * inner >= PARALLEL_THRESHOLD);
         }
+    } // namespace
 
+    class NativeElementWise : public CpuKernelWithoutConfig
+    {
         template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+        KernelFunc doPrepare(const Operator &_op,
+                             const RuntimeObj *context) const
         {
             auto op = as<ElementWiseObj>(_op);
             T *inptr0 = op->getInputs(0)->getRawDataPtr<T *>();
@@ -48,64 +150,45 @@ namespace infini
                       a.begin() + (rank - shapeA.size()));
             std::copy(shapeB.begin(), shapeB.end(),
                       b.begin() + (rank - shapeB.size()));
-            auto getStride = [&](const Shape &shape)
-            {
-                int p = 1;
-                Shape stride(rank);
-                for (auto i = rank; i > 0; --i)
-                {
-                    stride[i - 1] = p;
-                    p = p * shape[i - 1];
-                }
-                return stride;
-            };
-            Shape strideA = getStride(a);
-            Shape strideB = getStride(b);
+            auto layout = collapseBroadcast(a, b, shapeC);
 
-            auto n = op->getOutput()->size();
-            T (*_doCompute)
-            (T val0, T val1);
+            BinaryRowFunc<T> row;
             switch (op->getOpType().underlying())
             {
             case OpType::Add:
-                _doCompute = addCompute<T>;
+                row = selectBinaryRow<T, AddOp>();
                 break;
             case OpType::Sub:
-                _doCompute = subCompute<T>;
+                row = selectBinaryRow<T, SubOp>();
                 break;
             case OpType::Mul:
-                _doCompute = mulCompute<T>;
+                row = selectBinaryRow<T, MulOp>();
                 break;
             case OpType::Div:
-                _doCompute = divCompute<T>;
+                row = selectBinaryRow<T, DivOp>();
                 break;
             default:
                 IT_TODO_HALT();
             }
 
-            for (size_t i = 0; i < n; ++i)
-            {
-                auto shapeIndexC = locate_index(i, shapeC);
-                auto indexA = delocate_index(shapeIndexC, a, strideA);
-                auto indexB = delocate_index(shapeIndexC, b, strideB);
-                outptr[i] = _doCompute(inptr0[indexA], inptr1[indexB]);
-            }
+            return [=]()
+            { applyBroadcast<T>(layout, inptr0, inptr1, outptr, row); };
         }
 
-        void compute(const Operator &_op,
-                     const RuntimeObj *context) const override
+        KernelFunc prepare(const Operator &_op,
+                           const RuntimeObj *context) const override
         {
 #define CASE(N) \
     case N:     \
-        doCompute<DT<N>::t>(_op, context)
+        return doPrepare<DT<N>::t>(_op, context)
 
             int dataTypeIdx = _op->getDType().getIndex();
             switch (dataTypeIdx)
             {
-                CASE(1); // DataType::Float32
-                break;
+                CASE(1);  // DataType::Float32
+                CASE(10); // DataType::Float16
                 CASE(12); // DataType::UInt32
-                break;
+                CASE(16); // DataType::BFloat16
             default:
                 IT_TODO_HALT();
             }
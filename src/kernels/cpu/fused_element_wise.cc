@@ -0,0 +1,437 @@
+#include "operators/fused_element_wise.h"
+#include "core/kernel.h"
+#include "utils/simd.h"
+#include "utils/thread_pool.h"
+
+namespace infini
+{
+    namespace
+    {
+        // Below this many output elements the kernel runs on the calling
+        // thread only.
+        constexpr size_t PARALLEL_THRESHOLD = 1 << 15;
+        // Number of output elements handed to a thread at a time.
+        constexpr size_t CHUNK_SIZE = 1 << 13;
+        // Number of output elements evaluated at a time. Every value of the
+        // expression gets a float buffer of this size, so that all of them
+        // stay in L1 while the steps run over the block.
+        constexpr size_t BLOCK_SIZE = 256;
+
+        // Storage of a tensor; the expression is always computed in float.
+        enum class Storage
+        {
+            Float32,
+            Float16,
+            BFloat16,
+        };
+
+        Storage storageOf(DataType dtype)
+        {
+            if (dtype == DataType::Float32)
+                return Storage::Float32;
+            if (dtype == DataType::Float16)
+                return Storage::Float16;
+            if (dtype == DataType::BFloat16)
+                return Storage::BFloat16;
+            IT_TODO_HALT();
+        }
+
+        /**
+         * @brief Broadcast layout of the inputs against the output, like
+         * collapseBroadcast of NativeElementWise for any number of inputs.
+         * Output dims of size 1 are dropped and adjacent dims are merged
+         * whenever every input is broadcast on both or on neither. Strides
+         * are 0 on broadcast dims.
+         */
+        struct FusedLayout
+        {
+            vector<size_t> dims;
+            vector<vector<size_t>> strides;
+        };
+
+        FusedLayout collapseBroadcast(const vector<Shape> &inputs,
+                                      const Shape &c)
+        {
+            FusedLayout layout;
+            auto n = inputs.size();
+            vector<vector<bool>> bcast;
+            for (size_t d = 0; d < c.size(); ++d)
+            {
+                if (c[d] == 1)
+                    continue;
+                vector<bool> b(n);
+                for (size_t i = 0; i < n; ++i)
+                    b[i] = inputs[i][d] == 1;
+                if (!layout.dims.empty() && b == bcast.back())
+                {
+                    layout.dims.back() *= c[d];
+                    continue;
+                }
+                layout.dims.emplace_back(c[d]);
+                bcast.emplace_back(std::move(b));
+            }
+            if (layout.dims.empty())
+            {
+                layout.dims.emplace_back(1);
+                bcast.emplace_back(n, false);
+            }
+            auto rank = layout.dims.size();
+            layout.strides.assign(n, vector<size_t>(rank));
+            for (size_t i = 0; i < n; ++i)
+            {
+                size_t s = 1;
+                for (auto d = rank; d-- > 0;)
+                {
+                    layout.strides[i][d] = bcast[d][i] ? 0 : s;
+                    s *= bcast[d][i] ? 1 : layout.dims[d];
+                }
+            }
+            return layout;
+        }
+
+        /**
+         * @brief A step resolved to a row loop. Values are numbered like in
+         * FusedStep.
+         */
+        struct Instr
+        {
+            enum Kind
+            {
+                Binary, // binary(out, lhs, rhs)
+                Unary,  // unary(out, lhs)
+                Clamp,  // clamp(out, lhs, lo, hi)
+                Copy,   // out = lhs, then rounded
+                Alias,  // the value is lhs itself
+            } kind;
+            int lhs, rhs;
+            BinaryRowFunc<float> binary;
+            void (*unary)(float *, const float *, size_t);
+            ClampRowFunc<float> clamp;
+            float lo, hi;
+            // Storage the result is rounded to.
+            Storage round;
+        };
+
+        /**
+         * @brief Per-thread buffers: BLOCK_SIZE floats per value, BLOCK_SIZE
+         * 16-bit values for rounding, and the current pointer, stride and
+         * input offset of every value.
+         */
+        struct Scratch
+        {
+            vector<float> buf;
+            vector<uint16_t> tmp;
+            vector<const float *> ptr;
+            vector<size_t> stride, offs;
+
+            explicit Scratch(size_t nValues)
+                : buf(nValues * BLOCK_SIZE), tmp(BLOCK_SIZE), ptr(nValues),
+                  stride(nValues), offs(nValues) {}
+        };
+
+        struct Program
+        {
+            vector<Instr> instrs;
+            vector<Storage> inputStorage;
+            vector<const char *> inputs;
+            Storage outputStorage;
+            char *output;
+            FusedLayout layout;
+            WidenRowFunc<fp16_t> widenFp16;
+            WidenRowFunc<bf16_t> widenBf16;
+            NarrowRowFunc<fp16_t> narrowFp16;
+            NarrowRowFunc<bf16_t> narrowBf16;
+
+            // Read n elements of a tensor as floats. Float32 is read in place.
+            const float *load(Storage s, const char *p, float *buf,
+                              size_t n) const
+            {
+                switch (s)
+                {
+                case Storage::Float16:
+                    widenFp16(reinterpret_cast<const fp16_t *>(p), buf, n);
+                    return buf;
+                case Storage::BFloat16:
+                    widenBf16(reinterpret_cast<const bf16_t *>(p), buf, n);
+                    return buf;
+                default:
+                    return reinterpret_cast<const float *>(p);
+                }
+            }
+
+            void store(Storage s, const float *in, char *p, size_t n) const
+            {
+                switch (s)
+                {
+                case Storage::Float16:
+                    narrowFp16(in, reinterpret_cast<fp16_t *>(p), n);
+                    break;
+                case Storage::BFloat16:
+                    narrowBf16(in, reinterpret_cast<bf16_t *>(p), n);
+                    break;
+                default:
+                    std::memcpy(p, in, n * sizeof(float));
+                }
+            }
+
+            // Round n floats to a 16-bit storage type and back, in place.
+            void roundTo(Storage s, float *buf, uint16_t *tmp, size_t n) const
+            {
+                if (s == Storage::Float32)
+                    return;
+                store(s, buf, reinterpret_cast<char *>(tmp), n);
+                load(s, reinterpret_cast<const char *>(tmp), buf, n);
+            }
+
+            static size_t elemSize(Storage s)
+            {
+                return s == Storage::Float32 ? sizeof(float)
+                                             : sizeof(uint16_t);
+            }
+
+            /**
+             * @brief Evaluate the expression for "n" output elements starting
+             * at "outOff", whose inputs start at "s.offs" and advance by
+             * "strides" (0 or 1).
+             */
+            void evalBlock(Scratch &s, const size_t *strides, size_t outOff,
+                           size_t n) const
+            {
+                auto nIn = inputs.size();
+                // Values that do not vary along the row are computed once.
+                for (size_t i = 0; i < nIn; ++i)
+                {
+                    auto st = inputStorage[i];
+                    s.stride[i] = strides[i];
+                    s.ptr[i] = load(st, inputs[i] + s.offs[i] * elemSize(st),
+                                    s.buf.data() + i * BLOCK_SIZE,
+                                    strides[i] ? n : 1);
+                }
+                bool direct = false;
+                for (size_t k = 0; k < instrs.size(); ++k)
+                {
+                    auto &instr = instrs[k];
+                    auto v = nIn + k;
+                    auto a = s.ptr[instr.lhs];
+                    auto sa = s.stride[instr.lhs];
+                    if (instr.kind == Instr::Alias)
+                    {
+                        s.ptr[v] = a;
+                        s.stride[v] = sa;
+                        continue;
+                    }
+                    bool binary = instr.kind == Instr::Binary;
+                    auto b = binary ? s.ptr[instr.rhs] : nullptr;
+                    auto sb = binary ? s.stride[instr.rhs] : 0;
+                    s.stride[v] = sa | sb;
+                    auto len = s.stride[v] ? n : 1;
+                    // The last step writes a Float32 output directly; the
+                    // others are rounded here, as the store narrows the last.
+                    bool last = k + 1 == instrs.size();
+                    direct = last && s.stride[v] &&
+                             outputStorage == Storage::Float32;
+                    float *dst = direct ? reinterpret_cast<float *>(output) +
+                                              outOff
+                                        : s.buf.data() + v * BLOCK_SIZE;
+                    if (binary)
+                        instr.binary(dst, a, b, len, sa, sb);
+                    else if (instr.kind == Instr::Unary)
+                        instr.unary(dst, a, len);
+                    else if (instr.kind == Instr::Clamp)
+                        instr.clamp(dst, a, len, instr.lo, instr.hi);
+                    else
+                        std::copy(a, a + len, dst);
+                    if (!last)
+                        roundTo(instr.round, dst, s.tmp.data(), len);
+                    s.ptr[v] = dst;
+                }
+                if (direct)
+                    return;
+                auto v = nIn + instrs.size() - 1;
+                const float *result = s.ptr[v];
+                if (!s.stride[v])
+                {
+                    float *fill = s.buf.data() + v * BLOCK_SIZE;
+                    std::fill(fill, fill + n, *result);
+                    result = fill;
+                }
+                store(outputStorage, result,
+                      output + outOff * elemSize(outputStorage), n);
+            }
+
+            // Evaluate "len" output elements from "outOff" in blocks, with
+            // the inputs starting at "offs".
+            void evalSpan(Scratch &s, const size_t *offs,
+                          const size_t *strides, size_t outOff,
+                          size_t len) const
+            {
+                for (size_t start = 0; start < len; start += BLOCK_SIZE)
+                {
+                    for (size_t i = 0; i < inputs.size(); ++i)
+                        s.offs[i] = offs[i] + start * strides[i];
+                    evalBlock(s, strides, outOff + start,
+                              std::min(BLOCK_SIZE, len - start));
+                }
+            }
+
+            void run() const
+            {
+                auto rank = layout.dims.size();
+                auto nIn = inputs.size();
+                auto nValues = nIn + instrs.size();
+                size_t inner = layout.dims[rank - 1];
+                vector<size_t> innerStrides(nIn);
+                for (size_t i = 0; i < nIn; ++i)
+                    innerStrides[i] = layout.strides[i][rank - 1];
+                if (rank == 1)
+                {
+                    size_t nChunks = (inner + CHUNK_SIZE - 1) / CHUNK_SIZE;
+                    parallelFor(
+                        nChunks,
+                        [&](size_t c)
+                        {
+                            Scratch scratch(nValues);
+                            size_t start = c * CHUNK_SIZE;
+                            vector<size_t> offs(nIn);
+                            for (size_t i = 0; i < nIn; ++i)
+                                offs[i] = start * innerStrides[i];
+                            evalSpan(scratch, offs.data(), innerStrides.data(),
+                                     start, std::min(CHUNK_SIZE, inner - start));
+                        },
+                        inner >= PARALLEL_THRESHOLD);
+                    return;
+                }
+                // Walk the output row by row, like applyBroadcast of
+                // NativeElementWise.
+                size_t rows = 1;
+                for (size_t d = 0; d + 1 < rank; ++d)
+                    rows *= layout.dims[d];
+                size_t rowsPerChunk = std::max<size_t>(1, CHUNK_SIZE / inner);
+                size_t nChunks = (rows + rowsPerChunk - 1) / rowsPerChunk;
+                parallelFor(
+                    nChunks,
+                    [&](size_t c)
+                    {
+                        Scratch scratch(nValues);
+                        size_t r0 = c * rowsPerChunk,
+                               r1 = std::min(rows, r0 + rowsPerChunk);
+                        vector<size_t> idx(rank - 1), offs(nIn, 0);
+                        size_t rest = r0;
+                        for (auto d = rank - 1; d-- > 0;)
+                        {
+                            idx[d] = rest % layout.dims[d];
+                            rest /= layout.dims[d];
+                            for (size_t i = 0; i < nIn; ++i)
+                                offs[i] += idx[d] * layout.strides[i][d];
+                        }
+                        for (size_t r = r0; r < r1; ++r)
+                        {
+                            evalSpan(scratch, offs.data(), innerStrides.data(),
+                                     r * inner, inner);
+                            for (auto d = rank - 1; d-- > 0;)
+                            {
+                                for (size_t i = 0; i < nIn; ++i)
+                                    offs[i] += layout.strides[i][d];
+                                if (++idx[d] < layout.dims[d])
+                                    break;
+                                for (size_t i = 0; i < nIn; ++i)
+                                    offs[i] -= layout.strides[i][d] * layout.dims[d];
+                                idx[d] = 0;
+                            }
+                        }
+                    },
+                    rows * inner >= PARALLEL_THRESHOLD);
+            }
+        };
+
+        // Round a bound like the unfused Clip kernel stores it in its type.
+        float roundBound(Storage s, float v)
+        {
+            switch (s)
+            {
+            case Storage::Float16:
+                return fp16ToFloat(floatToFp16(v));
+            case Storage::BFloat16:
+                return bf16ToFloat(floatToBf16(v));
+            default:
+                return v;
+            }
+        }
+    } // namespace
+
+    class FusedElementWise : public CpuKernelWithoutConfig
+    {
+        KernelFunc prepare(const Operator &_op,
+                           const RuntimeObj *context) const override
+        {
+            auto op = as<FusedElementWiseObj>(_op);
+            auto program = std::make_shared<Program>();
+            auto shapeC = op->getOutput()->getDims();
+            auto rank = shapeC.size();
+            vector<Shape> shapes;
+            for (auto &input : op->getInputs())
+            {
+                auto dims = input->getDims();
+                Shape a(rank, 1);
+                std::copy(dims.begin(), dims.end(),
+                          a.begin() + (rank - dims.size()));
+                shapes.emplace_back(a);
+                program->inputStorage.emplace_back(
+                    storageOf(input->getDType()));
+                program->inputs.emplace_back(
+                    input->getRawDataPtr<const char *>());
+            }
+            program->layout = collapseBroadcast(shapes, shapeC);
+            program->outputStorage = storageOf(op->getOutput()->getDType());
+            program->output = op->getOutput()->getRawDataPtr<char *>();
+            program->widenFp16 = selectWidenRow<fp16_t>();
+            program->widenBf16 = selectWidenRow<bf16_t>();
+            program->narrowFp16 = selectNarrowRow<fp16_t>();
+            program->narrowBf16 = selectNarrowRow<bf16_t>();
+
+            for (auto &step : op->getSteps())
+            {
+                Instr instr{Instr::Binary, step.lhs, step.rhs, nullptr,
+                            nullptr, nullptr, 0.f, 0.f, storageOf(step.dtype)};
+                switch (step.type.underlying())
+                {
+                case OpType::Add:
+                    instr.binary = selectBinaryRow<float, AddOp>();
+                    break;
+                case OpType::Sub:
+                    instr.binary = selectBinaryRow<float, SubOp>();
+                    break;
+                case OpType::Mul:
+                    instr.binary = selectBinaryRow<float, MulOp>();
+                    break;
+                case OpType::Div:
+                    instr.binary = selectBinaryRow<float, DivOp>();
+                    break;
+                case OpType::Relu:
+                    instr.kind = Instr::Unary;
+                    instr.unary = reluRow<float>;
+                    break;
+                case OpType::Clip:
+                    instr.kind = Instr::Clamp;
+                    instr.clamp = selectClampRow<float>();
+                    instr.lo = roundBound(instr.round, step.min);
+                    instr.hi = roundBound(instr.round, step.max);
+                    break;
+                case OpType::Cast:
+                    // Widening is exact; narrowing is the rounding alone.
+                    instr.kind = instr.round == Storage::Float32 ? Instr::Alias
+                                                                 : Instr::Copy;
+                    break;
+                default:
+                    IT_TODO_HALT();
+                }
+                program->instrs.emplace_back(instr);
+            }
+            return [program]()
+            { program->run(); };
+        }
+    };
+
+    REGISTER_KERNEL(Device::CPU, OpType::FusedElementWise, FusedElementWise,
+                    "FusedElementWise_CPU");
+}; // namespace infini
@@ -0,0 +1,369 @@
+#include "operators/matmul.h"
+#include "core/kernel.h"
+#include "utils/cpu_features.h"
+#include "utils/simd.h"
+#include "utils/thread_pool.h"
+
+namespace infini {
+
+namespace {
+
+// Register tile computed by one micro-kernel call.
+constexpr int MR = 6, NR = 16;
+// Cache blocking: a KC x NR sliver of packed B stays in L1, an MC x KC block
+// of packed A in L2 and a KC x NC block of packed B in L3.
+constexpr int KC = 256, MC = 96, NC = 2048;
+// Below this many multiply-adds a GEMM runs on the calling thread only.
+constexpr size_t PARALLEL_THRESHOLD = 1 << 15;
+
+// Strided view of a matrix operand: element (i, j) lives at
+// ptr[i * rs + j * cs], so transA/transB are folded into packing. Elements
+// are read in their compute type, which widens 16-bit storage to float.
+template <typename T> struct MatView {
+    const T *ptr;
+    size_t rs, cs;
+    ComputeType<T> at(size_t i, size_t j) const {
+        return toCompute(ptr[i * rs + j * cs]);
+    }
+};
+
+template <typename T>
+using MicroKernel = void (*)(int kc, const T *a, const T *b, T *c, size_t ldc,
+                             bool accumulate);
+
+// Pack an mc x kc block of A into MR-row panels laid out column by column,
+// zero-padding the rows of the last panel.
+template <typename T, typename Acc = ComputeType<T>>
+void packA(const MatView<T> &a, int mc, int kc, Acc *buf, bool parallel) {
+    int nPanels = (mc + MR - 1) / MR;
+    parallelFor(
+        nPanels,
+        [&](size_t ip) {
+            Acc *dst = buf + ip * MR * kc;
+            int ir = ip * MR, mr = std::min(MR, mc - ir);
+            for (int p = 0; p < kc; ++p) {
+                for (int i = 0; i < mr; ++i)
+                    *dst++ = a.at(ir + i, p);
+                for (int i = mr; i < MR; ++i)
+                    *dst++ = Acc(0);
+            }
+        },
+        parallel);
+}
+
+// Pack a kc x nc block of B into NR-column panels laid out row by row,
+// zero-padding the columns of the last panel.
+template <typename T, typename Acc = ComputeType<T>>
+void packB(const MatView<T> &b, int kc, int nc, Acc *buf, bool parallel) {
+    int nPanels = (nc + NR - 1) / NR;
+    parallelFor(
+        nPanels,
+        [&](size_t jp) {
+            Acc *dst = buf + jp * NR * kc;
+            int jr = jp * NR, nr = std::min(NR, nc - jr);
+            for (int p = 0; p < kc; ++p) {
+                for (int j = 0; j < nr; ++j)
+                    *dst++ = b.at(p, jr + j);
+                for (int j = nr; j < NR; ++j)
+                    *dst++ = Acc(0);
+            }
+        },
+        parallel);
+}
+
+template <typename T>
+void microKernelGeneric(int kc, const T *a, const T *b, T *c, size_t ldc,
+                        bool accumulate) {
+    T acc[MR][NR] = {};
+    for (int p = 0; p < kc; ++p, a += MR, b += NR)
+        for (int i = 0; i < MR; ++i)
+            for (int j = 0; j < NR; ++j)
+                acc[i][j] += a[i] * b[j];
+    for (int i = 0; i < MR; ++i)
+        for (int j = 0; j < NR; ++j)
+            c[i * ldc + j] = accumulate ? c[i * ldc + j] + acc[i][j]
+                                        : acc[i][j];
+}
+
+#ifdef INFINI_SIMD_X86
+// 6x16 register tile: 12 ymm accumulators, 2 ymm for a row of B and one
+// broadcast of A.
+__attribute__((target("avx2,fma"))) void
+microKernelAvx2(int kc, const float *a, const float *b, float *c, size_t ldc,
+                bool accumulate) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+    for (int p = 0; p < kc; ++p, a += MR, b += NR) {
+        __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8);
+        __m256 ai;
+#define FMA_ROW(I)                                                             \
+    ai = _mm256_broadcast_ss(a + I);                                           \
+    c##I##0 = _mm256_fmadd_ps(ai, b0, c##I##0);                                \
+    c##I##1 = _mm256_fmadd_ps(ai, b1, c##I##1);
+        FMA_ROW(0) FMA_ROW(1) FMA_ROW(2) FMA_ROW(3) FMA_ROW(4) FMA_ROW(5)
+#undef FMA_ROW
+    }
+#define STORE_ROW(I)                                                           \
+    {                                                                          \
+        float *ci = c + I * ldc;                                               \
+        if (accumulate) {                                                      \
+            c##I##0 = _mm256_add_ps(c##I##0, _mm256_loadu_ps(ci));             \
+            c##I##1 = _mm256_add_ps(c##I##1, _mm256_loadu_ps(ci + 8));         \
+        }                                                                      \
+        _mm256_storeu_ps(ci, c##I##0);                                         \
+        _mm256_storeu_ps(ci + 8, c##I##1);                                     \
+    }
+    STORE_ROW(0) STORE_ROW(1) STORE_ROW(2) STORE_ROW(3) STORE_ROW(4)
+    STORE_ROW(5)
+#undef STORE_ROW
+}
+#endif
+
+/**
+ * @brief The epilogue of one batch, applied to each tile of C right after
+ * its last K block is stored, while the tile is still in L1. "ptr" of a
+ * Bias step is the bias row, and of a Residual step the residual matrix of
+ * the batch, with leading dimension "ld".
+ */
+struct TileEpilogue {
+    struct Step {
+        MatmulEpilogue::Kind kind;
+        const float *ptr;
+        size_t ld;
+        float lo, hi;
+    };
+    vector<Step> steps;
+    BinaryRowFunc<float> add;
+    ClampRowFunc<float> clamp;
+
+    // Apply the steps to the mr x nr block of C at (i0, j0).
+    void operator()(float *c, size_t ldc, int i0, int j0, int mr,
+                    int nr) const {
+        for (int i = 0; i < mr; ++i) {
+            float *row = c + i * ldc;
+            for (auto &step : steps) {
+                switch (step.kind) {
+                case MatmulEpilogue::Bias:
+                    add(row, row, step.ptr + j0, nr, 1, 1);
+                    break;
+                case MatmulEpilogue::Residual:
+                    add(row, row, step.ptr + (i0 + i) * step.ld + j0, nr, 1,
+                        1);
+                    break;
+                case MatmulEpilogue::Relu:
+                    reluRow(row, row, nr);
+                    break;
+                case MatmulEpilogue::Clip:
+                    clamp(row, row, nr, step.lo, step.hi);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+template <typename T> MicroKernel<T> selectMicroKernel() {
+#ifdef INFINI_SIMD_X86
+    if constexpr (std::is_same_v<T, float>)
+        if (getCpuIsa() >= CpuIsa::AVX2)
+            return microKernelAvx2;
+#endif
+    return microKernelGeneric<T>;
+}
+
+// C (m x n, leading dimension ldc) = A (m x k) * B (k x n), with C in the
+// compute type of T. The epilogue, if any, only exists for float.
+template <typename T, typename Acc = ComputeType<T>>
+void gemm(int m, int n, int k, const MatView<T> &a, const MatView<T> &b,
+          Acc *c, size_t ldc, MicroKernel<Acc> kernel,
+          const TileEpilogue *epilogue = nullptr) {
+    if (k == 0) {
+        for (int i = 0; i < m; ++i)
+            std::fill_n(c + i * ldc, n, Acc(0));
+        if constexpr (std::is_same_v<Acc, float>)
+            if (epilogue)
+                (*epilogue)(c, ldc, 0, 0, m, n);
+        return;
+    }
+    bool parallel = (size_t)m * n * k >= PARALLEL_THRESHOLD;
+    vector<Acc> bufA((size_t)MC * KC);
+    vector<Acc> bufB((size_t)KC * ((std::min(n, NC) + NR - 1) / NR * NR));
+    for (int jc = 0; jc < n; jc += NC) {
+        int nc = std::min(NC, n - jc);
+        for (int pc = 0; pc < k; pc += KC) {
+            int kc = std::min(KC, k - pc);
+            bool accumulate = pc > 0, last = pc + kc == k;
+            MatView<T> bBlock{b.ptr + pc * b.rs + jc * b.cs, b.rs, b.cs};
+            packB(bBlock, kc, nc, bufB.data(), parallel);
+            for (int ic = 0; ic < m; ic += MC) {
+                int mc = std::min(MC, m - ic);
+                MatView<T> aBlock{a.ptr + ic * a.rs + pc * a.cs, a.rs, a.cs};
+                packA(aBlock, mc, kc, bufA.data(), parallel);
+                int nPanelsN = (nc + NR - 1) / NR, nPanelsM = (mc + MR - 1) / MR;
+                parallelFor(
+                    (size_t)nPanelsN * nPanelsM,
+                    [&](size_t w) {
+                        int jp = w / nPanelsM, ip = w % nPanelsM;
+                        int jr = jp * NR, ir = ip * MR;
+                        int nr = std::min(NR, nc - jr), mr = std::min(MR, mc - ir);
+                        const Acc *pa = bufA.data() + (size_t)ip * MR * kc;
+                        const Acc *pb = bufB.data() + (size_t)jp * NR * kc;
+                        Acc *pc_ = c + (ic + ir) * ldc + jc + jr;
+                        if (mr == MR && nr == NR) {
+                            kernel(kc, pa, pb, pc_, ldc, accumulate);
+                        } else {
+                            // Edge tile: compute the full tile aside and
+                            // merge only the valid part.
+                            Acc tile[MR * NR];
+                            kernel(kc, pa, pb, tile, NR, false);
+                            for (int i = 0; i < mr; ++i)
+                                for (int j = 0; j < nr; ++j)
+                                    pc_[i * ldc + j] =
+                                        accumulate
+                                            ? pc_[i * ldc + j] + tile[i * NR + j]
+                                            : tile[i * NR + j];
+                        }
+                        if constexpr (std::is_same_v<Acc, float>)
+                            if (epilogue && last)
+                                (*epilogue)(pc_, ldc, ic + ir, jc + jr, mr, nr);
+                    },
+                    parallel);
+            }
+        }
+    }
+}
+
+// Element offsets of every output batch into an operand whose leading
+// (batch) dimensions are broadcast to `outBatch`.
+vector<size_t> batchOffsets(const Shape &dims, const Shape &outBatch,
+                            size_t matSize) {
+    int rank = outBatch.size(), batchRank = dims.size() - 2;
+    vector<size_t> stride(rank, 0);
+    size_t s = matSize;
+    for (int i = batchRank - 1; i >= 0; --i) {
+        stride[i + rank - batchRank] = dims[i] == 1 ? 0 : s;
+        s *= dims[i];
+    }
+    size_t nBatch = 1;
+    for (auto d : outBatch)
+        nBatch *= d;
+    vector<size_t> ret(nBatch);
+    Shape idx(rank, 0);
+    size_t cur = 0;
+    for (size_t bi = 0; bi < nBatch; ++bi) {
+        ret[bi] = cur;
+        for (int d = rank - 1; d >= 0; --d) {
+            cur += stride[d];
+            if (++idx[d] < outBatch[d])
+                break;
+            cur -= stride[d] * outBatch[d];
+            idx[d] = 0;
+        }
+    }
+    return ret;
+}
+
+} // namespace
+
+class BlockedMatmul : public CpuKernelWithoutConfig {
+    template <typename T>
+    KernelFunc doPrepare(const Operator &_op,
+                         const RuntimeObj *context) const {
+        auto op = as<MatmulObj>(_op);
+        auto A = op->getInputs(0), B = op->getInputs(1), C = op->getOutput();
+        int m = op->getM(), n = op->getN(), k = op->getK();
+        auto outDim = C->getDims();
+        Shape outBatch(outDim.begin(), outDim.end() - 2);
+        auto offA = batchOffsets(A->getDims(), outBatch, (size_t)m * k);
+        auto offB = batchOffsets(B->getDims(), outBatch, (size_t)k * n);
+
+        auto aPtr = A->getRawDataPtr<T *>(), bPtr = B->getRawDataPtr<T *>(),
+             cPtr = C->getRawDataPtr<T *>();
+        auto kernel = selectMicroKernel<ComputeType<T>>();
+        vector<pair<MatView<T>, MatView<T>>> batches;
+        for (size_t bi = 0; bi < offA.size(); ++bi) {
+            MatView<T> a = op->getTransA()
+                               ? MatView<T>{aPtr + offA[bi], 1, (size_t)m}
+                               : MatView<T>{aPtr + offA[bi], (size_t)k, 1};
+            MatView<T> b = op->getTransB()
+                               ? MatView<T>{bPtr + offB[bi], 1, (size_t)k}
+                               : MatView<T>{bPtr + offB[bi], (size_t)n, 1};
+            batches.emplace_back(a, b);
+        }
+        if (!op->getEpilogue().empty()) {
+            // The epilogue is only fused for Float32, see
+            // populateEpiloguePatterns.
+            IT_ASSERT(C->getDType() == DataType::Float32);
+            auto outSize = (size_t)m * n;
+            vector<TileEpilogue> epilogues(batches.size());
+            for (size_t bi = 0; bi < batches.size(); ++bi) {
+                auto &ep = epilogues[bi];
+                ep.add = selectBinaryRow<float, AddOp>();
+                ep.clamp = selectClampRow<float>();
+                size_t input = 2;
+                for (auto &step : op->getEpilogue()) {
+                    TileEpilogue::Step s{step.kind, nullptr, (size_t)n,
+                                         step.min, step.max};
+                    if (step.kind == MatmulEpilogue::Bias)
+                        s.ptr = op->getInputs(input++)->getRawDataPtr<float *>();
+                    else if (step.kind == MatmulEpilogue::Residual)
+                        s.ptr = op->getInputs(input++)
+                                    ->getRawDataPtr<float *>() +
+                                bi * outSize;
+                    ep.steps.emplace_back(s);
+                }
+            }
+            if constexpr (std::is_same_v<T, float>)
+                return [=]() {
+                    for (size_t bi = 0; bi < batches.size(); ++bi)
+                        gemm<T>(m, n, k, batches[bi].first,
+                                batches[bi].second, cPtr + bi * outSize, n,
+                                kernel, &epilogues[bi]);
+                };
+        }
+        if constexpr (isHalfType<T>) {
+            // Accumulate in float and round to 16 bits once per batch.
+            auto narrow = selectNarrowRow<T>();
+            return [=]() {
+                vector<float> acc((size_t)m * n);
+                for (size_t bi = 0; bi < batches.size(); ++bi) {
+                    gemm<T>(m, n, k, batches[bi].first, batches[bi].second,
+                            acc.data(), n, kernel);
+                    narrow(acc.data(), cPtr + bi * m * n, acc.size());
+                }
+            };
+        } else {
+            return [=]() {
+                for (size_t bi = 0; bi < batches.size(); ++bi)
+                    gemm<T>(m, n, k, batches[bi].first, batches[bi].second,
+                            cPtr + bi * m * n, n, kernel);
+            };
+        }
+    }
+
+    KernelFunc prepare(const Operator &_op,
+                       const RuntimeObj *context) const override {
+#define CASE(N)                                                                \
+    case N:                                                                    \
+        return doPrepare<DT<N>::t>(_op, context)
+
+        int dataTypeIdx = _op->getDType().getIndex();
+        switch (dataTypeIdx) {
+            CASE(1);  // DataType::Float32
+            CASE(10); // DataType::Float16
+            CASE(12); // DataType::UInt32
+            CASE(16); // DataType::BFloat16
+        default:
+            IT_TODO_HALT();
+        }
+    }
+};
+
+REGISTER_KERNEL(Device::CPU, OpType::MatMul, BlockedMatmul,
+                "MatmulBlocked_CPU");
+
+} // namespace infini
@@ -1,60 +1,296 @@
 #include "operators/transpose.h"
 #include "core/kernel.h"
+#include "utils/simd.h"
+#include "utils/thread_pool.h"
+#include <cstring>
 
 namespace infini {
 
-inline Shape idx2Pos(const Shape &shape, size_t idx) {
-    Shape pos = Shape(shape.size(), 0);
-    auto rest = idx, curDimId = shape.size() - 1;
-    while (rest > 0) {
-        pos[curDimId] = rest % shape[curDimId];
-        rest /= shape[curDimId];
-        curDimId--;
+namespace {
+
+// Below this many elements the kernel runs on the calling thread only.
+constexpr size_t PARALLEL_THRESHOLD = 1 << 15;
+// Number of elements handed to a thread at a time by the copy paths.
+constexpr size_t CHUNK_SIZE = 1 << 13;
+// Side of the square tiles of the 2D transpose path; a pair of 32x32 tiles
+// of 32-bit elements fits in L1.
+constexpr size_t TILE = 32;
+
+/**
+ * @brief Transpose with size-1 dims dropped and adjacent input dims merged
+ * whenever they stay adjacent and in order under the permutation, so e.g.
+ * NCHW -> NHWC becomes the batched 2D transpose [N, C, HW] -> [N, HW, C].
+ */
+struct TransposeLayout {
+    vector<size_t> dims; // Input dims.
+    vector<int> perm;    // Output dim j is input dim perm[j].
+};
+
+TransposeLayout coalesceTranspose(const Shape &inDim, const vector<int> &perm) {
+    // Runs of input dims that stay consecutive in the output, in output order.
+    vector<pair<int, int>> groups;
+    for (auto d : perm) {
+        if (inDim[d] == 1)
+            continue;
+        if (!groups.empty()) {
+            int next = groups.back().second + 1;
+            while (next < d && inDim[next] == 1)
+                ++next;
+            if (next == d) {
+                groups.back().second = d;
+                continue;
+            }
+        }
+        groups.emplace_back(d, d);
+    }
+    // Number the merged dims by their position in the input.
+    vector<int> order(groups.size());
+    for (size_t g = 0; g < groups.size(); ++g)
+        order[g] = g;
+    std::sort(order.begin(), order.end(), [&](int x, int y) {
+        return groups[x].first < groups[y].first;
+    });
+    TransposeLayout layout;
+    layout.perm.resize(groups.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto [first, last] = groups[order[i]];
+        size_t size = 1;
+        for (int d = first; d <= last; ++d)
+            size *= inDim[d];
+        layout.dims.emplace_back(size);
+        layout.perm[order[i]] = i;
+    }
+    return layout;
+}
+
+// out[j * ldOut + i] = in[i * ldIn + j] for a rows x cols block of `in`.
+template <typename T>
+using TileFunc = void (*)(const T *in, size_t ldIn, T *out, size_t ldOut,
+                          size_t rows, size_t cols);
+
+template <typename T>
+void transposeTileGeneric(const T *in, size_t ldIn, T *out, size_t ldOut,
+                          size_t rows, size_t cols) {
+    for (size_t j = 0; j < cols; ++j)
+        for (size_t i = 0; i < rows; ++i)
+            out[j * ldOut + i] = in[i * ldIn + j];
+}
+
+#ifdef INFINI_SIMD_X86
+// 8x8 transpose in registers: interleave pairs of rows, then pairs of pairs,
+// then swap the 128-bit halves.
+INFINI_TARGET_AVX2 inline void transpose8x8(const float *in, size_t ldIn,
+                                            float *out, size_t ldOut) {
+    __m256 r0 = _mm256_loadu_ps(in + 0 * ldIn);
+    __m256 r1 = _mm256_loadu_ps(in + 1 * ldIn);
+    __m256 r2 = _mm256_loadu_ps(in + 2 * ldIn);
+    __m256 r3 = _mm256_loadu_ps(in + 3 * ldIn);
+    __m256 r4 = _mm256_loadu_ps(in + 4 * ldIn);
+    __m256 r5 = _mm256_loadu_ps(in + 5 * ldIn);
+    __m256 r6 = _mm256_loadu_ps(in + 6 * ldIn);
+    __m256 r7 = _mm256_loadu_ps(in + 7 * ldIn);
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+    __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(out + 0 * ldOut, _mm256_permute2f128_ps(u0, u4, 0x20));
+    _mm256_storeu_ps(out + 1 * ldOut, _mm256_permute2f128_ps(u1, u5, 0x20));
+    _mm256_storeu_ps(out + 2 * ldOut, _mm256_permute2f128_ps(u2, u6, 0x20));
+    _mm256_storeu_ps(out + 3 * ldOut, _mm256_permute2f128_ps(u3, u7, 0x20));
+    _mm256_storeu_ps(out + 4 * ldOut, _mm256_permute2f128_ps(u0, u4, 0x31));
+    _mm256_storeu_ps(out + 5 * ldOut, _mm256_permute2f128_ps(u1, u5, 0x31));
+    _mm256_storeu_ps(out + 6 * ldOut, _mm256_permute2f128_ps(u2, u6, 0x31));
+    _mm256_storeu_ps(out + 7 * ldOut, _mm256_permute2f128_ps(u3, u7, 0x31));
+}
+
+// Any 32-bit element is moved through float registers; only its bits matter.
+template <typename T>
+INFINI_TARGET_AVX2 void transposeTileAvx2(const T *in, size_t ldIn, T *out,
+                                          size_t ldOut, size_t rows,
+                                          size_t cols) {
+    static_assert(sizeof(T) == sizeof(float));
+    auto fin = reinterpret_cast<const float *>(in);
+    auto fout = reinterpret_cast<float *>(out);
+    size_t rows8 = rows / 8 * 8, cols8 = cols / 8 * 8;
+    for (size_t i = 0; i < rows8; i += 8)
+        for (size_t j = 0; j < cols8; j += 8)
+            transpose8x8(fin + i * ldIn + j, ldIn, fout + j * ldOut + i,
+                         ldOut);
+    transposeTileGeneric(in + cols8, ldIn, out + cols8 * ldOut, ldOut, rows8,
+                         cols - cols8);
+    transposeTileGeneric(in + rows8 * ldIn, ldIn, out + rows8, ldOut,
+                         rows - rows8, cols);
+}
+#endif
+
+template <typename T> TileFunc<T> selectTileFunc(CpuIsa isa = getCpuIsa()) {
+#ifdef INFINI_SIMD_X86
+    if constexpr (sizeof(T) == sizeof(float))
+        if (isa >= CpuIsa::AVX2)
+            return transposeTileAvx2<T>;
+#endif
+    return transposeTileGeneric<T>;
+}
+
+template <typename T>
+KernelFunc prepareTranspose(const TransposeLayout &layout, const T *in,
+                            T *out) {
+    int rank = layout.dims.size();
+    size_t size = 1;
+    for (auto d : layout.dims)
+        size *= d;
+    bool parallel = size >= PARALLEL_THRESHOLD;
+    if (size == 0)
+        return []() {};
+
+    // Nothing moves: one flat copy.
+    if (rank <= 1) {
+        return [=]() {
+            size_t nChunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            parallelFor(
+                nChunks,
+                [&](size_t c) {
+                    size_t start = c * CHUNK_SIZE;
+                    std::memcpy(out + start, in + start,
+                                std::min(CHUNK_SIZE, size - start) * sizeof(T));
+                },
+                parallel);
+        };
+    }
+
+    vector<size_t> inStride(rank), outDims(rank), outStride(rank);
+    size_t s = 1;
+    for (int d = rank - 1; d >= 0; --d) {
+        inStride[d] = s;
+        s *= layout.dims[d];
+    }
+    for (int j = 0; j < rank; ++j)
+        outDims[j] = layout.dims[layout.perm[j]];
+    s = 1;
+    for (int j = rank - 1; j >= 0; --j) {
+        outStride[j] = s;
+        s *= outDims[j];
     }
-    return pos;
+
+    // The innermost dim stays innermost: copy whole rows, walking the output
+    // rows with counters over the permuted input strides.
+    if (layout.perm[rank - 1] == rank - 1) {
+        size_t inner = layout.dims[rank - 1], rows = size / inner;
+        vector<size_t> rowDims(outDims.begin(), outDims.end() - 1), rowStride;
+        for (int j = 0; j < rank - 1; ++j)
+            rowStride.emplace_back(inStride[layout.perm[j]]);
+        size_t rowsPerChunk = std::max<size_t>(1, CHUNK_SIZE / inner);
+        return [=]() {
+            size_t nChunks = (rows + rowsPerChunk - 1) / rowsPerChunk;
+            parallelFor(
+                nChunks,
+                [&](size_t c) {
+                    size_t r0 = c * rowsPerChunk,
+                           r1 = std::min(rows, r0 + rowsPerChunk);
+                    vector<size_t> idx(rank - 1);
+                    size_t offset = 0, rest = r0;
+                    for (int d = rank - 2; d >= 0; --d) {
+                        idx[d] = rest % rowDims[d];
+                        rest /= rowDims[d];
+                        offset += idx[d] * rowStride[d];
+                    }
+                    for (size_t r = r0; r < r1; ++r) {
+                        std::memcpy(out + r * inner, in + offset,
+                                    inner * sizeof(T));
+                        for (int d = rank - 2; d >= 0; --d) {
+                            offset += rowStride[d];
+                            if (++idx[d] < rowDims[d])
+                                break;
+                            offset -= rowStride[d] * rowDims[d];
+                            idx[d] = 0;
+                        }
+                    }
+                },
+                parallel);
+        };
+    }
+
+    // Otherwise the input's innermost dim and the output's innermost dim
+    // (input dim q) form a 2D transpose for every index of the other dims.
+    // Work items are (outer index, block of TILE rows of q) pairs.
+    int q = layout.perm[rank - 1];
+    int a = std::find(layout.perm.begin(), layout.perm.end(), rank - 1) -
+            layout.perm.begin();
+    size_t rows = layout.dims[q], cols = layout.dims[rank - 1];
+    size_t ldIn = inStride[q], ldOut = outStride[a];
+    vector<size_t> outerDims, outerInStride, outerOutStride;
+    for (int j = 0; j < rank; ++j) {
+        if (j == a || j == rank - 1)
+            continue;
+        outerDims.emplace_back(outDims[j]);
+        outerInStride.emplace_back(inStride[layout.perm[j]]);
+        outerOutStride.emplace_back(outStride[j]);
+    }
+    size_t nBlocks = (rows + TILE - 1) / TILE;
+    size_t nWork = size / (rows * cols) * nBlocks;
+    auto tile = selectTileFunc<T>();
+    return [=]() {
+        parallelFor(
+            nWork,
+            [&](size_t w) {
+                size_t outer = w / nBlocks, i0 = w % nBlocks * TILE;
+                size_t inOffset = i0 * ldIn, outOffset = i0;
+                for (int d = outerDims.size() - 1; d >= 0; --d) {
+                    size_t idx = outer % outerDims[d];
+                    outer /= outerDims[d];
+                    inOffset += idx * outerInStride[d];
+                    outOffset += idx * outerOutStride[d];
+                }
+                size_t tileRows = std::min(TILE, rows - i0);
+                for (size_t j0 = 0; j0 < cols; j0 += TILE)
+                    tile(in + inOffset + j0, ldIn, out + outOffset + j0 * ldOut,
+                         ldOut, tileRows, std::min(TILE, cols - j0));
+            },
+            parallel);
+    };
 }
 
-class NaiveTranspose : public CpuKernelWithoutConfig {
+} // namespace
+
+class TiledTranspose : public CpuKernelWithoutConfig {
     template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+    KernelFunc doPrepare(const Operator &_op,
+                         const RuntimeObj *context) const {
         auto op = as<TransposeObj>(_op);
-        auto inputs = op->getInputs(), outputs = op->getOutputs();
-        const auto &inDim = inputs[0]->getDims();
-        const auto &perm = op->getPermute();
-
-        size_t inSize = inputs[0]->size();
-        auto inPtr = inputs[0]->getRawDataPtr<T *>(),
-             outPtr = outputs[0]->getRawDataPtr<T *>();
-        // #pragma omp parallel for
-        for (size_t inIdx = 0; inIdx < inSize; ++inIdx) {
-            auto posInput = idx2Pos(inDim, inIdx);
-            int outIdx = 0;
-            for (size_t j = 0, jEnd = perm.size(); j < jEnd; ++j) {
-                outIdx = outIdx * inDim[perm[j]] + posInput[perm[j]];
-            }
-            outPtr[outIdx] = inPtr[inIdx];
-        }
+        auto layout =
+            coalesceTranspose(op->getInputs(0)->getDims(), op->getPermute());
+        return prepareTranspose<T>(layout,
+                                   op->getInputs(0)->getRawDataPtr<T *>(),
+                                   op->getOutput()->getRawDataPtr<T *>());
     }
 
-    void compute(const Operator &_op,
-                 const RuntimeObj *context) const override {
+    KernelFunc prepare(const Operator &_op,
+                       const RuntimeObj *context) const override {
 #define CASE(N)                                                                \
     case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
+        return doPrepare<DT<N>::t>(_op, context)
 
         int dataTypeIdx = _op->getDType().getIndex();
         switch (dataTypeIdx) {
-            CASE(1); // DataType::Float32
-            break;
+            CASE(1);  // DataType::Float32
+            CASE(10); // DataType::Float16
             CASE(12); // DataType::UInt32
-            break;
+            CASE(16); // DataType::BFloat16
         default:
             IT_TODO_HALT();
         }
     }
 };
 
-REGISTER_KERNEL(Device::CPU, OpType::Transpose, NaiveTranspose,
-                "TransposeNaive_CPU");
+REGISTER_KERNEL(Device::CPU, OpType::Transpose, TiledTranspose,
+                "TransposeTiled_CPU");
 
 } // namespace infini
@@ -1,57 +1,45 @@
 #include "operators/unary.h"
 #include "core/kernel.h"
+#include "utils/simd.h"
+#include <limits>
 
 namespace infini
 {
     class NativeUnary : public CpuKernelWithoutConfig
     {
         template <typename T>
-        static T reluCompute(T val)
-        {
-            return std::max(T(0), val);
-        }
-
-        template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+        KernelFunc doPrepare(const Operator &_op,
+                             const RuntimeObj *context) const
         {
             auto op = as<UnaryObj>(_op);
             T *inptr = op->getInputs(0)->getRawDataPtr<T *>();
             T *outptr = op->getOutput()->getRawDataPtr<T *>();
 
-            auto outDim = op->getOutput()->getDims();
             auto n = op->getOutput()->size();
 
-            T (*_doCompute)
-            (T val);
             switch (op->getOpType().underlying())
             {
             case OpType::Relu:
-                _doCompute = reluCompute<T>;
-                break;
+                return [=]() { reluRow(outptr, inptr, n); };
             default:
                 IT_TODO_HALT();
             }
-
-            for (size_t offset = 0; offset < n; offset++)
-            {
-                outptr[offset] = _doCompute(inptr[offset]);
-            }
         }
 
-        void compute(const Operator &_op,
-                     const RuntimeObj *context) const override
+        KernelFunc prepare(const Operator &_op,
+                           const RuntimeObj *context) const override
         {
 #define CASE(N) \
     case N:     \
-        doCompute<DT<N>::t>(_op, context)
+        return doPrepare<DT<N>::t>(_op, context)
 
             int dataTypeIdx = _op->getDType().getIndex();
             switch (dataTypeIdx)
             {
-                CASE(1); // DataType::Float32
-                break;
+                CASE(1);  // DataType::Float32
+                CASE(10); // DataType::Float16
                 CASE(12); // DataType::UInt32
-                break;
+                CASE(16); // DataType::BFloat16
             default:
                 IT_TODO_HALT();
             }
@@ -60,39 +48,53 @@ namespace infini
 
     class Clip : public CpuKernelWithoutConfig
     {
+        // Saturate a float bound into the range of T.
         template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+        static T clipBound(float v)
+        {
+            if constexpr (std::is_integral_v<T>)
+            {
+                if (v <= float(std::numeric_limits<T>::lowest()))
+                    return std::numeric_limits<T>::lowest();
+                if (v >= float(std::numeric_limits<T>::max()))
+                    return std::numeric_limits<T>::max();
+            }
+            return fromCompute<T>(v);
+        }
+
+        template <typename T>
+        KernelFunc doPrepare(const Operator &_op,
+                             const RuntimeObj *context) const
         {
             auto op = as<ClipObj>(_op);
             T *inptr = op->getInputs(0)->getRawDataPtr<T *>();
             T *outptr = op->getOutput()->getRawDataPtr<T *>();
-            auto minValue = op->getMin();
-            auto maxValue = op->getMax();
+            // A missing bound clamps to the whole range of T, which leaves
+            // every value (NaN included) unchanged.
+            constexpr float inf = std::numeric_limits<float>::infinity();
+            T lo = clipBound<T>(op->getMin().value_or(-inf));
+            T hi = clipBound<T>(op->getMax().value_or(inf));
 
             auto n = op->getOutput()->size();
-            for (size_t offset = 0; offset < n; offset++)
-            {
-                auto val = *inptr++;
-                *outptr++ = (minValue && val < *minValue)   ? *minValue
-                            : (maxValue && val > *maxValue) ? *maxValue
-                                                            : val;
-            }
+            auto row = selectClampRow<T>();
+            return [=]()
+            { row(outptr, inptr, n, lo, hi); };
         }
 
-        void compute(const Operator &_op,
-                     const RuntimeObj *context) const override
+        KernelFunc prepare(const Operator &_op,
+                           const RuntimeObj *context) const override
         {
 #define CASE(N) \
     case N:     \
-        doCompute<DT<N>::t>(_op, context)
+        return doPrepare<DT<N>::t>(_op, context)
 
             int dataTypeIdx = _op->getDType().getIndex();
             switch (dataTypeIdx)
             {
-                CASE(1); // DataType::Float32
-                break;
+                CASE(1);  // DataType::Float32
+                CASE(10); // DataType::Float16
                 CASE(12); // DataType::UInt32
-                break;
+                CASE(16); // DataType::BFloat16
             default:
                 IT_TODO_HALT();
             }
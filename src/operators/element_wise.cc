@@ -30,4 +30,16 @@ namespace infini
         return os.str();
     }
 
+    vector<int> ElementWiseObj::getOpAttrVector() const
+    {
+        return {type.underlying()};
+    }
+
+    OpCost ElementWiseObj::getCost() const
+    {
+        auto cost = OperatorObj::getCost();
+        cost.flops = outputs[0]->size();
+        return cost;
+    }
+
 }; // namespace infini
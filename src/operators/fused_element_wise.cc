@@ -0,0 +1,70 @@
+#include "operators/fused_element_wise.h"
+#include "utils/operator_utils.h"
+
+namespace infini {
+FusedElementWiseObj::FusedElementWiseObj(GraphObj *graph, TensorVec inputs,
+                                         Tensor output,
+                                         vector<FusedStep> steps)
+    : OperatorObj(OpType::FusedElementWise, inputs, {output}),
+      steps(std::move(steps)) {
+  IT_ASSERT(!this->steps.empty());
+  IT_ASSERT(checkValid(graph));
+}
+
+optional<vector<Shape>> FusedElementWiseObj::inferShape(
+    const TensorVec &inputs) {
+  // every step reads values defined before it
+  int defined = inputs.size();
+  for (auto &step : steps) {
+    bool binary = step.type == OpType::Add || step.type == OpType::Sub ||
+                  step.type == OpType::Mul || step.type == OpType::Div;
+    if (step.lhs < 0 || step.lhs >= defined ||
+        (binary && (step.rhs < 0 || step.rhs >= defined)))
+      return std::nullopt;
+    ++defined;
+  }
+  Shape shape = inputs[0]->getDims();
+  for (size_t i = 1; i < inputs.size(); ++i)
+    shape = infer_broadcast(shape, inputs[i]->getDims());
+  return {{shape}};
+}
+
+vector<DataType>
+FusedElementWiseObj::inferDataType(const TensorVec &inputs) const {
+  return {steps.back().dtype};
+}
+
+std::string FusedElementWiseObj::toString() const {
+  std::ostringstream os;
+  os << type.toString() << "[" << getGuid() << "]";
+  os << "(";
+  for (size_t i = 0; i < steps.size(); ++i)
+    os << (i ? "," : "") << steps[i].type.toString();
+  os << ",inputs=[";
+  for (size_t i = 0; i < inputs.size(); ++i)
+    os << (i ? "," : "") << inputs[i]->getGuid();
+  os << "],output=" << outputs[0]->getGuid() << ")";
+  return os.str();
+}
+
+vector<int> FusedElementWiseObj::getOpAttrVector() const {
+  vector<int> ret{type.underlying()};
+  for (auto &step : steps)
+    ret.insert(ret.end(),
+               {step.type.underlying(), step.lhs, step.rhs,
+                int(floatToBits(step.min)), int(floatToBits(step.max)),
+                step.dtype.getIndex()});
+  return ret;
+}
+
+OpCost FusedElementWiseObj::getCost() const {
+  // only the fused inputs and the output touch memory; a Cast step is just
+  // a rounding
+  auto cost = OperatorObj::getCost();
+  for (auto &step : steps)
+    if (step.type != OpType::Cast)
+      cost.flops += (step.type == OpType::Clip ? 2. : 1.) * outputs[0]->size();
+  return cost;
+}
+
+} // namespace infini
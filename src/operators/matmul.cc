@@ -11,13 +11,32 @@ namespace infini
         IT_ASSERT(checkValid(graph));
     }
 
+    MatmulObj::MatmulObj(GraphObj *graph, TensorVec inputs, Tensor C,
+                         bool transA, bool transB,
+                         vector<MatmulEpilogue> epilogue)
+        : OperatorObj(OpType::MatMul, inputs, {C}), transA(transA),
+          transB(transB), epilogue(std::move(epilogue))
+    {
+        IT_ASSERT(checkValid(graph));
+    }
+
     string MatmulObj::toString() const
     {
+        static const char *names[] = {"Bias", "Residual", "Relu", "Clip"};
         std::ostringstream os;
         os << "Matmul([" << (transA ? "A^T" : "A") << "," << (transB ? "B^T" : "B]")
            << ",A=" << inputs[0]->getGuid()
            << ",B=" << inputs[1]->getGuid() << ",C=" << outputs[0]->getGuid()
-           << ",mnk=[" << m << "," << n << "," << k << "])";
+           << ",mnk=[" << m << "," << n << "," << k << "]";
+        size_t input = 2;
+        for (auto &step : epilogue)
+        {
+            os << "," << names[step.kind];
+            if (step.kind == MatmulEpilogue::Bias ||
+                step.kind == MatmulEpilogue::Residual)
+                os << "=" << inputs[input++]->getGuid();
+        }
+        os << ")";
         return os.str();
     }
 
@@ -46,7 +65,11 @@ namespace infini
         // TODO：返回经过 matmul 操作后的 shape
         // REF: https://github.com/onnx/onnx/blob/main/docs/Operators.md#gemm
         // =================================== 作业 ==================================='
-        if(inputs.size() != 2)
+        size_t nTensors = 0;
+        for (auto &step : epilogue)
+            nTensors += step.kind == MatmulEpilogue::Bias ||
+                        step.kind == MatmulEpilogue::Residual;
+        if (inputs.size() != 2 + nTensors)
             return std::nullopt;
         auto A = inputs[0]->getDims();
         auto B = inputs[1]->getDims();
@@ -66,6 +89,9 @@ namespace infini
         // Check if matrix multiplication is valid
         IT_ASSERT(rankA >= 2 && rankB >= 2);
         IT_ASSERT(A[rankA-1] == B[rankB-2]); // Inner dimensions must match
+        m = A[rankA-2];
+        n = B[rankB-1];
+        k = A[rankA-1];
 
         // Calculate output shape
         Shape outShape;
@@ -83,7 +109,44 @@ namespace infini
         outShape.push_back(A[rankA-2]); // M dimension
         outShape.push_back(B[rankB-1]); // N dimension
 
+        // 尾声的偏置只在最后一维为 N，残差与输出同形
+        size_t input = 2;
+        for (auto &step : epilogue)
+        {
+            if (step.kind == MatmulEpilogue::Bias)
+            {
+                auto bias = inputs[input++];
+                if (bias->getRank() == 0 || bias->getRank() > outShape.size() ||
+                    bias->getDims().back() != n || bias->size() != (size_t)n)
+                    return std::nullopt;
+            }
+            else if (step.kind == MatmulEpilogue::Residual)
+            {
+                if (inputs[input++]->getDims() != outShape)
+                    return std::nullopt;
+            }
+        }
+
         return {{outShape}};
     }
 
+    vector<int> MatmulObj::getOpAttrVector() const
+    {
+        vector<int> ret{type.underlying(), transA, transB};
+        for (auto &step : epilogue)
+            ret.insert(ret.end(), {step.kind, int(floatToBits(step.min)),
+                                   int(floatToBits(step.max))});
+        return ret;
+    }
+
+    OpCost MatmulObj::getCost() const
+    {
+        // one multiply-add per (output, k) pair, and one operation per
+        // output element for every epilogue step
+        auto cost = OperatorObj::getCost();
+        double size = outputs[0]->size();
+        cost.flops = 2 * size * k + size * epilogue.size();
+        return cost;
+    }
+
 } // namespace infini
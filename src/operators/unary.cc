@@ -21,6 +21,14 @@ std::string UnaryObj::toString() const {
   return os.str();
 }
 
+vector<int> UnaryObj::getOpAttrVector() const { return {type.underlying()}; }
+
+OpCost UnaryObj::getCost() const {
+  auto cost = OperatorObj::getCost();
+  cost.flops = outputs[0]->size();
+  return cost;
+}
+
 ClipObj::ClipObj(GraphObj *graph, Tensor input, Tensor output,
                  std::optional<float> min, std::optional<float> max)
     : OperatorObj(OpType::Clip, {input}, {output}), minValue(min),
@@ -52,6 +60,20 @@ std::string ClipObj::toString() const {
   return os.str();
 }
 
+vector<int> ClipObj::getOpAttrVector() const {
+  // a missing bound is told apart from every float by its flag
+  return {type.underlying(), minValue.has_value(),
+          int(floatToBits(minValue.value_or(0.f))), maxValue.has_value(),
+          int(floatToBits(maxValue.value_or(0.f)))};
+}
+
+OpCost ClipObj::getCost() const {
+  auto cost = OperatorObj::getCost();
+  cost.flops = double(outputs[0]->size()) * (minValue.has_value() +
+                                             maxValue.has_value());
+  return cost;
+}
+
 CastObj::CastObj(GraphObj *graph, Tensor input, Tensor output, CastType type)
     : OperatorObj(OpType::Cast, {input}, {output}), castType(type) {
   IT_ASSERT(checkValid(graph));
@@ -97,6 +119,10 @@ std::string CastObj::toString() const {
   return os.str();
 }
 
+vector<int> CastObj::getOpAttrVector() const {
+  return {type.underlying(), int(castType)};
+}
+
 DataType CastObj::getOutputDataType() const {
   switch (castType) {
   case CastType::Float2Float16:
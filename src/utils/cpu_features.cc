@@ -0,0 +1,60 @@
+#include "utils/cpu_features.h"
+#include <initializer_list>
+#include <unistd.h>
+
+namespace infini {
+
+static CpuIsa detectCpuIsa() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl"))
+        return CpuIsa::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("f16c"))
+        return CpuIsa::AVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return CpuIsa::SSE42;
+#endif
+    return CpuIsa::Generic;
+}
+
+CpuIsa getCpuIsa() {
+    static const CpuIsa isa = detectCpuIsa();
+    return isa;
+}
+
+static size_t detectLastLevelCacheSize() {
+#if defined(_SC_LEVEL3_CACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+    for (int name : {_SC_LEVEL3_CACHE_SIZE, _SC_LEVEL2_CACHE_SIZE}) {
+        long size = sysconf(name);
+        if (size > 0)
+            return size;
+    }
+#endif
+    return 8 << 20;
+}
+
+size_t getLastLevelCacheSize() {
+    static const size_t size = detectLastLevelCacheSize();
+    return size;
+}
+
+const char *cpuIsaToString(CpuIsa isa) {
+    switch (isa) {
+    case CpuIsa::Generic:
+        return "Generic";
+    case CpuIsa::SSE42:
+        return "SSE4.2";
+    case CpuIsa::AVX2:
+        return "AVX2";
+    case CpuIsa::AVX512:
+        return "AVX512";
+    default:
+        return "Unknown";
+    }
+}
+
+} // namespace infini
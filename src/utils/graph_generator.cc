@@ -0,0 +1,191 @@
+#include "utils/graph_generator.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include <numeric>
+#include <random>
+
+namespace infini {
+
+const char *graphTopologyToString(GraphTopology topology) {
+    switch (topology) {
+    case GraphTopology::Chain:
+        return "Chain";
+    case GraphTopology::FanOut:
+        return "FanOut";
+    case GraphTopology::TransposeHeavy:
+        return "TransposeHeavy";
+    case GraphTopology::ConcatHeavy:
+        return "ConcatHeavy";
+    case GraphTopology::Mixed:
+        return "Mixed";
+    }
+    return "Unknown";
+}
+
+namespace {
+
+enum Kind { Binary, Unary, Transpose, MatMul, ConcatGroup };
+
+class Builder {
+  public:
+    Builder(Graph g, const GraphGeneratorConfig &config)
+        : g(g), config(config), rng(config.seed) {
+        for (size_t i = 0; i < config.numInputs; ++i)
+            inputs.emplace_back(g->addTensor(config.shape, config.dtype));
+        produced = inputs;
+    }
+
+    void build() {
+        // relative frequency of each kind of step, indexed by Kind
+        vector<double> weights;
+        switch (config.topology) {
+        case GraphTopology::Chain:
+            weights = {4, 4, 1, 1, 0};
+            break;
+        case GraphTopology::FanOut:
+            weights = {6, 2, 1, 1, 1};
+            break;
+        case GraphTopology::TransposeHeavy:
+            weights = {2, 1, 6, 1, 0};
+            break;
+        case GraphTopology::ConcatHeavy:
+            weights = {2, 1, 0, 1, 6};
+            break;
+        case GraphTopology::Mixed:
+            weights = {3, 2, 2, 1, 1};
+            break;
+        }
+        std::discrete_distribution<int> kind(weights.begin(), weights.end());
+        // the inputs come first so that each of them is read
+        while (nextInput < inputs.size() ||
+               g->getOperators().size() < config.numOps) {
+            switch (kind(rng)) {
+            case Binary:
+                binary();
+                break;
+            case Unary:
+                unary();
+                break;
+            case Transpose:
+                transpose();
+                break;
+            case MatMul:
+                matmul();
+                break;
+            case ConcatGroup:
+                concatGroup();
+                break;
+            }
+        }
+    }
+
+  private:
+    size_t uniform(size_t n) {
+        return std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+    }
+
+    // An operand for the next operator: an input nobody has read yet, or
+    // else a tensor chosen by the topology. "nth" tells apart the operands
+    // of one operator in a chain.
+    Tensor pick(size_t nth = 0) {
+        if (nextInput < inputs.size())
+            return inputs[nextInput++];
+        size_t n = produced.size();
+        switch (config.topology) {
+        case GraphTopology::Chain:
+            return produced[n - 1 - std::min(nth, n - 1)];
+        case GraphTopology::FanOut:
+            return produced[uniform(n)];
+        default:
+            // a window of recent tensors keeps the graph deep but branchy
+            return produced[n - 1 - uniform(std::min<size_t>(n, 16))];
+        }
+    }
+
+    Tensor push(const Tensor &tensor) {
+        produced.emplace_back(tensor);
+        return tensor;
+    }
+
+    void binary() {
+        auto a = pick(0), b = pick(1);
+        switch (uniform(3)) {
+        case 0:
+            push(g->addOp<AddObj>(a, b, nullptr)->getOutput());
+            break;
+        case 1:
+            push(g->addOp<SubObj>(a, b, nullptr)->getOutput());
+            break;
+        default:
+            push(g->addOp<MulObj>(a, b, nullptr)->getOutput());
+            break;
+        }
+    }
+
+    void unary() {
+        auto x = pick();
+        if (uniform(2))
+            push(g->addOp<ReluObj>(x, nullptr)->getOutput());
+        else
+            push(g->addOp<ClipObj>(x, nullptr, -1.f, 1.f)->getOutput());
+    }
+
+    void transpose() {
+        vector<int> perm(config.shape.size());
+        std::iota(perm.begin(), perm.end(), 0);
+        do {
+            std::shuffle(perm.begin(), perm.end(), rng);
+        } while (std::is_sorted(perm.begin(), perm.end()));
+        auto y = g->addOp<TransposeObj>(pick(), nullptr, perm)->getOutput();
+        // half of them are undone right away, as layout changes often are
+        if (config.topology == GraphTopology::TransposeHeavy && uniform(2)) {
+            vector<int> inverse(perm.size());
+            for (size_t i = 0; i < perm.size(); ++i)
+                inverse[perm[i]] = i;
+            y = g->addOp<TransposeObj>(y, nullptr, inverse)->getOutput();
+        }
+        push(y);
+    }
+
+    void matmul() {
+        auto a = pick(0), b = pick(1);
+        push(g->addOp<MatmulObj>(a, b, nullptr, uniform(2), uniform(2))
+                 ->getOutput());
+    }
+
+    // k tensors of shape [..., m, n] are concatenated into A [..., m, k*n]
+    // and B [..., k*m, n], and A x B is of shape [..., m, n] again as m = n.
+    void concatGroup() {
+        TensorVec parts;
+        for (size_t i = 0, k = 2 + uniform(3); i < k; ++i)
+            parts.emplace_back(pick(i));
+        int rank = config.shape.size();
+        auto a = g->addOp<ConcatObj>(parts, nullptr, rank - 1)->getOutput();
+        auto b = g->addOp<ConcatObj>(parts, nullptr, rank - 2)->getOutput();
+        push(g->addOp<MatmulObj>(a, b, nullptr)->getOutput());
+    }
+
+    Graph g;
+    const GraphGeneratorConfig &config;
+    std::mt19937 rng;
+    TensorVec inputs, produced;
+    size_t nextInput = 0;
+};
+
+} // namespace
+
+Graph generateGraph(Runtime runtime, const GraphGeneratorConfig &config) {
+    auto &shape = config.shape;
+    IT_ASSERT(shape.size() >= 2 && config.numInputs > 0);
+    IT_ASSERT(std::all_of(shape.begin(), shape.end(),
+                          [&](int d) { return d == shape[0]; }),
+              "generateGraph needs a shape with equal dimensions");
+    Graph g = make_ref<GraphObj>(runtime);
+    Builder(g, config).build();
+    return g;
+}
+
+} // namespace infini
@@ -0,0 +1,144 @@
+#include "utils/perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace infini {
+
+const char *perfEventToString(PerfEvent event) {
+    switch (event) {
+    case PerfEvent::Cycles:
+        return "cycles";
+    case PerfEvent::Instructions:
+        return "instructions";
+    case PerfEvent::LLCMisses:
+        return "LLC misses";
+    case PerfEvent::DTLBMisses:
+        return "dTLB misses";
+    case PerfEvent::BranchMisses:
+        return "branch misses";
+    }
+    return "unknown";
+}
+
+PerfSample PerfSample::operator-(const PerfSample &before) const {
+    PerfSample ret;
+    ret.timeEnabled = timeEnabled - before.timeEnabled;
+    ret.timeRunning = timeRunning - before.timeRunning;
+    if (ret.timeRunning == 0)
+        return ret;
+    double scale = double(ret.timeEnabled) / ret.timeRunning;
+    for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+        ret.valid[i] = valid[i] && before.valid[i];
+        if (ret.valid[i])
+            ret.values[i] = uint64_t(double(values[i] - before.values[i]) *
+                                         scale +
+                                     0.5);
+    }
+    return ret;
+}
+
+#ifdef __linux__
+static int openEvent(PerfEvent event, int leader) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    auto cache = [](uint64_t id, uint64_t result) {
+        return id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    };
+    switch (event) {
+    case PerfEvent::Cycles:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfEvent::Instructions:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfEvent::LLCMisses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cache(PERF_COUNT_HW_CACHE_LL,
+                            PERF_COUNT_HW_CACHE_RESULT_MISS);
+        break;
+    case PerfEvent::DTLBMisses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cache(PERF_COUNT_HW_CACHE_DTLB,
+                            PERF_COUNT_HW_CACHE_RESULT_MISS);
+        break;
+    case PerfEvent::BranchMisses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+    // user space only, which the default perf_event_paranoid level allows
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // the members follow the leader, which starts once all have joined
+    attr.disabled = leader < 0;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+#endif
+
+PerfCounters::PerfCounters() {
+    fds.fill(-1);
+#ifdef __linux__
+    for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+        fds[i] = openEvent(PerfEvent(i), leader);
+        if (leader < 0)
+            leader = fds[i];
+    }
+    if (leader >= 0)
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : fds)
+        if (fd >= 0)
+            close(fd);
+#endif
+}
+
+PerfCounters &PerfCounters::forThisThread() {
+    static thread_local PerfCounters counters;
+    return counters;
+}
+
+bool PerfCounters::anyAvailable() const {
+    for (int fd : fds)
+        if (fd >= 0)
+            return true;
+    return false;
+}
+
+PerfSample PerfCounters::read() const {
+    PerfSample sample;
+#ifdef __linux__
+    if (leader < 0)
+        return sample;
+    // nr, time enabled, time running, then one value per member in the
+    // order they joined, which is the order of the events
+    std::array<uint64_t, 3 + NUM_PERF_EVENTS> buffer;
+    auto bytes = ::read(leader, buffer.data(), sizeof(buffer));
+    if (bytes < ssize_t(3 * sizeof(uint64_t)))
+        return sample;
+    size_t nr = buffer[0], k = 0;
+    sample.timeEnabled = buffer[1];
+    sample.timeRunning = buffer[2];
+    for (size_t i = 0; i < NUM_PERF_EVENTS && k < nr; ++i) {
+        if (fds[i] < 0)
+            continue;
+        sample.values[i] = buffer[3 + k++];
+        sample.valid[i] = true;
+    }
+#endif
+    return sample;
+}
+
+} // namespace infini
@@ -0,0 +1,177 @@
+#include "utils/thread_pool.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace infini {
+
+// The pool the current thread works for, nullptr outside of one, and the
+// index of the deque it owns there.
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local size_t currentIndex = 0;
+// parallelFor() calls of the current thread that other threads helped with
+static thread_local size_t sharedLoopCount = 0;
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    size_t nWorkers = numThreads > 1 ? numThreads - 1 : 0;
+    // Without workers the one deque is drained by the waiting threads.
+    for (size_t i = 0; i < std::max<size_t>(nWorkers, 1); ++i)
+        queues.emplace_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < nWorkers; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+static size_t defaultThreads() {
+    if (auto env = std::getenv("OMP_NUM_THREADS")) {
+        int n = std::atoi(env);
+        if (n > 0)
+            return n;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ThreadPool &ThreadPool::getInstance() {
+    static ThreadPool pool(defaultThreads());
+    return pool;
+}
+
+void ThreadPool::submit(Task task) {
+    size_t index = currentPool == this
+                       ? currentIndex
+                       : nextQueue.fetch_add(1) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.emplace_back(std::move(task));
+    }
+    pending.fetch_add(1);
+    // Taking the lock orders this wake-up after a worker's check of
+    // "pending", so the notification cannot be lost.
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool ThreadPool::runOne() {
+    Task task;
+    size_t n = queues.size();
+    bool own = currentPool == this;
+    size_t first = own ? currentIndex : 0;
+    for (size_t k = 0; k < n && !task; ++k) {
+        auto &queue = *queues[(first + k) % n];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        // the newest task of the own deque is the hottest in cache; the
+        // oldest task of another deque is the largest piece left to steal
+        if (own && k == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task)
+        return false;
+    pending.fetch_sub(1);
+    task();
+    return true;
+}
+
+bool ThreadPool::helpLoop() {
+    if (openLoops.load() == 0)
+        return false;
+    Loop *loop = nullptr;
+    size_t r = 0;
+    {
+        // The range is claimed under the lock: its owner cannot return, and
+        // so free the loop, before the range is done.
+        std::lock_guard<std::mutex> lock(loopMutex);
+        for (auto l : loops) {
+            r = l->next.fetch_add(1);
+            if (r < l->nRanges) {
+                loop = l;
+                break;
+            }
+        }
+    }
+    if (!loop)
+        return false;
+    loop->shared.store(true, std::memory_order_relaxed);
+    loop->run(r);
+    loop->left.fetch_sub(1);
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+    while (true) {
+        // a waiting kernel holds a thread, so its loop goes first
+        if (helpLoop() || runOne())
+            continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] {
+            return stop || pending.load() > 0 || openLoops.load() > 0;
+        });
+        if (stop)
+            return;
+    }
+}
+
+void ThreadPool::waitUntil(const std::function<bool()> &done) {
+    while (!done())
+        if (!helpLoop() && !runOne())
+            std::this_thread::yield();
+}
+
+void ThreadPool::parallelFor(size_t n,
+                             const std::function<void(size_t, size_t)> &body) {
+    // a few ranges per thread, so that the load evens out
+    size_t nRanges = std::min(n, size() * 4);
+    if (nRanges < 2) {
+        body(0, n);
+        return;
+    }
+    Loop loop;
+    loop.body = &body;
+    loop.n = n;
+    loop.nRanges = nRanges;
+    loop.left = nRanges;
+    {
+        std::lock_guard<std::mutex> lock(loopMutex);
+        loops.emplace_back(&loop);
+    }
+    openLoops.fetch_add(1);
+    if (!workers.empty()) {
+        // see submit()
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wake.notify_all();
+    }
+    // only ranges of this loop: a task run here would nest in the kernel
+    for (size_t r; (r = loop.next.fetch_add(1)) < nRanges;) {
+        loop.run(r);
+        loop.left.fetch_sub(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(loopMutex);
+        loops.erase(std::find(loops.begin(), loops.end(), &loop));
+    }
+    openLoops.fetch_sub(1);
+    while (loop.left.load() > 0)
+        std::this_thread::yield();
+    if (loop.shared.load(std::memory_order_relaxed))
+        ++sharedLoopCount;
+}
+
+size_t ThreadPool::sharedLoops() { return sharedLoopCount; }
+
+} // namespace infini
@@ -71,4 +71,56 @@ namespace infini
         EXPECT_EQ(ptr1, ptr2);
     }
 
+    TEST(Allocator, testAllocAfterFreeNoOverlap)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        // allocate a->b->c
+        size_t offsetA = allocator.alloc(48);
+        allocator.alloc(48);
+        size_t offsetC = allocator.alloc(48);
+        // free a, then allocate d which does not fit into a's hole
+        allocator.free(offsetA, 48);
+        size_t offsetD = allocator.alloc(96);
+        // expected to be placed after c instead of overlapping it
+        EXPECT_GE(offsetD, offsetC + 48);
+        // e fits into a's hole
+        size_t offsetE = allocator.alloc(48);
+        EXPECT_EQ(offsetE, offsetA);
+    }
+
+    TEST(Allocator, testBestFit)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        // holes of 96, 32 and 64 bytes separated by live blocks
+        size_t sizes[6] = {96, 8, 32, 8, 64, 8}, offsets[6];
+        for (size_t i = 0; i < 6; ++i)
+            offsets[i] = allocator.alloc(sizes[i]);
+        allocator.free(offsets[0], 96);
+        allocator.free(offsets[2], 32);
+        allocator.free(offsets[4], 64);
+        // each request takes the smallest hole that fits
+        EXPECT_EQ(allocator.alloc(24), offsets[2]);
+        EXPECT_EQ(allocator.alloc(64), offsets[4]);
+        EXPECT_EQ(allocator.alloc(40), offsets[0]);
+        // the remainder of the 96-byte hole is still free
+        EXPECT_EQ(allocator.alloc(56), offsets[0] + 40);
+    }
+
+    TEST(Allocator, testCoalesce)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        size_t a = allocator.alloc(32);
+        size_t b = allocator.alloc(32);
+        size_t c = allocator.alloc(32);
+        allocator.alloc(32);
+        // freeing a, c and then b leaves one 96-byte hole at a
+        allocator.free(a, 32);
+        allocator.free(c, 32);
+        allocator.free(b, 32);
+        EXPECT_EQ(allocator.alloc(96), a);
+    }
+
 } // namespace infini
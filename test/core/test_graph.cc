@@ -1,8 +1,12 @@
 #include "core/graph.h"
 #include "core/kernel.h"
 #include "core/runtime.h"
+#include "operators/element_wise.h"
 #include "operators/matmul.h"
 #include "operators/transpose.h"
+#include "operators/unary.h"
+#include <functional>
+#include <numeric>
 
 #include "test.h"
 
@@ -37,4 +41,526 @@ namespace infini
         EXPECT_EQ(op->getTransA(), false);
         EXPECT_EQ(op->getTransB(), true);
     }
-}
\ No newline at end of file
+
+    TEST(Graph, DataMallocReuse)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3, 4}, DataType::Float32);
+        auto r1 = g->addOp<ReluObj>(i, nullptr);
+        auto r2 = g->addOp<ReluObj>(r1->getOutput(), nullptr);
+        auto r3 = g->addOp<ReluObj>(r2->getOutput(), nullptr);
+        auto r4 = g->addOp<ReluObj>(r3->getOutput(), nullptr);
+        g->dataMalloc();
+        // r1's output is dead once r2 has run, so r3 reuses its buffer
+        EXPECT_EQ(r1->getOutput()->getRawDataPtr<void *>(),
+                  r3->getOutput()->getRawDataPtr<void *>());
+        // graph inputs and outputs are never shared
+        EXPECT_NE(i->getRawDataPtr<void *>(),
+                  r4->getOutput()->getRawDataPtr<void *>());
+        EXPECT_NE(r3->getOutput()->getRawDataPtr<void *>(),
+                  r4->getOutput()->getRawDataPtr<void *>());
+
+        i->setData(IncrementalGenerator());
+        runtime->run(g);
+        vector<float> ans(i->size());
+        std::iota(ans.begin(), ans.end(), 0.f);
+        EXPECT_TRUE(r4->getOutput()->equalData(ans));
+    }
+
+    TEST(Graph, CompilePlan)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3}, DataType::Float32);
+        auto r1 = g->addOp<ReluObj>(i, nullptr);
+        auto r2 = g->addOp<ReluObj>(r1->getOutput(), nullptr);
+        g->dataMalloc();
+        EXPECT_FALSE(g->isCompiled());
+        i->setData(IncrementalGenerator());
+        runtime->run(g);
+        // the first run compiles the graph, later runs reuse the plan
+        ASSERT_TRUE(g->isCompiled());
+        ASSERT_EQ(g->getPlan().size(), 2u);
+        EXPECT_EQ(g->getPlan()[0].op, r1);
+        EXPECT_EQ(g->getPlan()[1].op, r2);
+        runtime->run(g);
+        EXPECT_TRUE(r2->getOutput()->equalData(vector<float>{0, 1, 2, 3, 4, 5}));
+        // changing the graph drops the plan
+        g->addOp<ReluObj>(r2->getOutput(), nullptr);
+        EXPECT_FALSE(g->isCompiled());
+    }
+
+    TEST(Graph, TopoSortPolicy)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({64, 64}, DataType::Float32);
+        Tensor w = g->addTensor({64, 1}, DataType::Float32);
+        Tensor p = g->addTensor({64, 64}, DataType::Float32);
+        Tensor r = g->addTensor({64, 64}, DataType::Float32);
+        Tensor q = g->addTensor({64, 1}, DataType::Float32);
+        Tensor s = g->addTensor({64, 1}, DataType::Float32);
+        Tensor o = g->addTensor({64, 1}, DataType::Float32);
+        // added consumers first, so the insertion order is not topological
+        auto add = g->addOpWithOutputs<AddObj>(q, s, o);
+        auto mq = g->addOpWithOutputs<MatmulObj>(p, w, q);
+        auto ms = g->addOpWithOutputs<MatmulObj>(r, w, s);
+        auto rp = g->addOpWithOutputs<ReluObj>(x, p);
+        auto rr = g->addOpWithOutputs<ReluObj>(x, r);
+
+        // every ready op is taken in insertion order: both 64x64
+        // intermediates are alive together
+        ASSERT_TRUE(g->topo_sort());
+        EXPECT_EQ(g->getOperators(), (OpVec{rp, rr, mq, ms, add}));
+        // each branch is finished before the next one starts
+        ASSERT_TRUE(g->topo_sort(TopoSortPolicy::Locality));
+        EXPECT_EQ(g->getOperators(), (OpVec{rp, mq, rr, ms, add}));
+        // the matmul shrinks p, so it runs as soon as it is ready
+        ASSERT_TRUE(g->topo_sort(TopoSortPolicy::Stable));
+        ASSERT_TRUE(g->topo_sort(TopoSortPolicy::Memory));
+        EXPECT_EQ(g->getOperators(), (OpVec{rp, mq, rr, ms, add}));
+        // an already sorted graph is not sorted again
+        ASSERT_TRUE(g->topo_sort());
+        EXPECT_EQ(g->getOperators(), (OpVec{rp, mq, rr, ms, add}));
+    }
+
+    TEST(Graph, ScheduleForMemory)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({64, 64}, DataType::Float32);
+        Tensor w = g->addTensor({64, 1}, DataType::Float32);
+        // four branches each widen x to a 64x64 intermediate and shrink it
+        TensorVec branches;
+        for (int i = 0; i < 4; ++i)
+            branches.emplace_back(g->addOp<ReluObj>(x, nullptr)->getOutput());
+        Tensor sum;
+        for (auto &p : branches)
+        {
+            auto q = g->addOp<MatmulObj>(p, w, nullptr)->getOutput();
+            sum = sum ? g->addOp<AddObj>(sum, q, nullptr)->getOutput() : q;
+        }
+        // x, w and the output stay resident: 16384 + 256 + 256 bytes
+        const size_t resident = 16896;
+        // breadth first, all four intermediates are alive at once
+        ASSERT_TRUE(g->topo_sort());
+        EXPECT_EQ(g->estimatePeakMemory(), resident + 4 * 16384 + 256);
+        // one intermediate at a time, next to two small partial results
+        EXPECT_EQ(g->scheduleForMemory(), resident + 16384 + 2 * 256);
+        EXPECT_EQ(g->estimatePeakMemory(), resident + 16384 + 2 * 256);
+        EXPECT_TRUE(g->checkValid());
+        // the order found is kept when nothing beats it
+        auto order = g->getOperators();
+        EXPECT_EQ(g->scheduleForMemory(0), resident + 16384 + 2 * 256);
+        EXPECT_EQ(g->getOperators(), order);
+        g->dataMalloc();
+    }
+
+    TEST(Graph, ParallelRun)
+    {
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        TensorVec relus, products;
+        auto g = checkTransform(
+            {{64, 64}, {64, 8}}, [&](Graph g, TensorVec in)
+            {
+                relus.clear();
+                products.clear();
+                Tensor sum;
+                for (int i = 0; i < 4; ++i)
+                {
+                    relus.emplace_back(
+                        g->addOp<ReluObj>(in[0], nullptr)->getOutput());
+                    products.emplace_back(
+                        g->addOp<MatmulObj>(relus.back(), in[1], nullptr)
+                            ->getOutput());
+                    sum = sum ? g->addOp<AddObj>(sum, products.back(), nullptr)
+                                    ->getOutput()
+                              : products.back();
+                }
+                // one 64x64 intermediate at a time, so the branches share
+                // memory
+                g->scheduleForMemory();
+                return sum; },
+            [&](Graph, TensorVec) { runtime->setParallel(true); });
+        runtime->setParallel(false);
+        // the second Relu reuses the memory of the first one, so it waits
+        // for the MatMul reading it although no tensor links them
+        ASSERT_EQ(relus[1]->getRawDataPtr<void *>(),
+                  relus[0]->getRawDataPtr<void *>());
+        auto &plan = g->getPlan();
+        auto at = [&](const Tensor &t)
+        {
+            for (size_t i = 0; i < plan.size(); ++i)
+                if (plan[i].op == t->getSource())
+                    return i;
+            return plan.size();
+        };
+        auto &succs = plan[at(products[0])].successors;
+        EXPECT_NE(std::find(succs.begin(), succs.end(), at(relus[1])),
+                  succs.end());
+        EXPECT_EQ(plan[at(relus[0])].numPredecessors, 0u);
+        // run it a few more times to shake out races
+        auto output = g->getOutputs()[0];
+        vector<float> expected(output->getRawDataPtr<float *>(),
+                               output->getRawDataPtr<float *>() +
+                                   output->size());
+        runtime->setParallel(true);
+        for (int i = 0; i < 20; ++i)
+            runtime->run(g);
+        runtime->setParallel(false);
+        EXPECT_TRUE(output->equalData(expected));
+    }
+
+    TEST(Graph, TopoSortRing)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3}, DataType::Float32);
+        Tensor a = g->addTensor({2, 3}, DataType::Float32);
+        Tensor b = g->addTensor({2, 3}, DataType::Float32);
+        Tensor c = g->addTensor({2, 3}, DataType::Float32);
+        auto r0 = g->addOpWithOutputs<ReluObj>(i, a);
+        auto add = g->addOpWithOutputs<AddObj>(a, c, b);
+        auto r1 = g->addOpWithOutputs<ReluObj>(b, c);
+        EXPECT_FALSE(g->topo_sort());
+        EXPECT_FALSE(g->topo_sort(TopoSortPolicy::Locality));
+        EXPECT_FALSE(g->topo_sort(TopoSortPolicy::Memory));
+        // the graph is left untouched
+        EXPECT_EQ(g->getOperators(), (OpVec{r0, add, r1}));
+    }
+
+    TEST(Graph, IndexedRemoval)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3}, DataType::Float32);
+        OpVec relus;
+        for (int k = 0; k < 5; ++k)
+            relus.emplace_back(
+                g->addOp<ReluObj>(k ? relus.back()->getOutput() : i, nullptr));
+        for (auto &op : relus) {
+            EXPECT_EQ(g->getOperator(op->getGuid()), op);
+            EXPECT_EQ(g->getTensor(op->getOutput()->getFuid()),
+                      op->getOutput());
+        }
+
+        // links are the caller's business, only the storage is checked here
+        auto removed = relus[1];
+        auto dead = removed->getOutput();
+        g->removeOperator(removed);
+        g->removeTensor(dead);
+        // removing twice, or something never added, does nothing
+        g->removeOperator(removed);
+        Graph other = make_ref<GraphObj>(runtime);
+        g->removeTensor(other->addTensor({1}, DataType::Float32));
+
+        EXPECT_FALSE(g->hasOperator(removed));
+        EXPECT_FALSE(g->hasTensor(dead));
+        EXPECT_EQ(g->getOperator(removed->getGuid()), nullptr);
+        EXPECT_EQ(g->getTensor(dead->getFuid()), nullptr);
+        EXPECT_TRUE(g->hasOperator(relus[4]));
+        EXPECT_EQ(g->getTensor(relus[4]->getOutput()->getFuid()),
+                  relus[4]->getOutput());
+        // the order of what is left is kept
+        EXPECT_EQ(g->getOperators(),
+                  (OpVec{relus[0], relus[2], relus[3], relus[4]}));
+        EXPECT_EQ(g->getTensors().size(), 5u);
+        EXPECT_EQ(g->getOperator(relus[3]->getGuid()), relus[3]);
+        EXPECT_EQ(g->getTensors()[0], i);
+    }
+
+    TEST(Graph, RewriteWorklist)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        OpVec relus;
+        for (int k = 0; k < 4; ++k)
+            relus.emplace_back(
+                g->addOp<ReluObj>(k ? relus.back()->getOutput() : x, nullptr));
+        auto add = g->addOp<AddObj>(relus.back()->getOutput(), x, nullptr);
+
+        // Relu(Relu(x)) == Relu(x)
+        int calls = 0;
+        RewritePatternSet patterns;
+        patterns.add(OpType::Relu, "DropRepeatedRelu",
+                     [&calls](GraphObj &graph, const Operator &op)
+                     {
+                         ++calls;
+                         auto input = op->getInputs(0);
+                         auto prev = input->getSource();
+                         if (!prev || prev->getOpType() != OpType::Relu)
+                             return false;
+                         graph.replaceAllUses(op->getOutput(), input);
+                         graph.eraseOperator(op);
+                         return true;
+                     });
+        EXPECT_EQ(g->applyPatterns(patterns), 3u);
+        // only the neighbours of each rewrite are tried again
+        EXPECT_LT(calls, 8);
+        EXPECT_EQ(g->getOperators(), (OpVec{relus[0], add}));
+        EXPECT_EQ(add->getInputs(0), relus[0]->getOutput());
+        EXPECT_EQ(relus[0]->getSuccessors(), OpVec{add});
+        EXPECT_EQ(add->getPredecessors(), OpVec{relus[0]});
+        EXPECT_EQ(g->getTensors().size(), 3u);
+        EXPECT_TRUE(g->checkValid());
+        // nothing left to do
+        EXPECT_EQ(g->applyPatterns(patterns), 0u);
+    }
+
+    TEST(Graph, OptimizeSharedTranspose)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3, 4}, DataType::Float32);
+        auto t1 = g->addOp<TransposeObj>(i, nullptr, Shape{1, 2, 0});
+        auto t2 = g->addOp<TransposeObj>(t1->getOutput(), nullptr,
+                                         Shape{2, 0, 1});
+        auto r1 = g->addOp<ReluObj>(t2->getOutput(), nullptr);
+        auto r2 = g->addOp<ReluObj>(t1->getOutput(), nullptr);
+        // A and B are the same transposed tensor
+        Tensor j = g->addTensor({4, 4}, DataType::Float32);
+        auto t3 = g->addOp<TransposeObj>(j, nullptr, Shape{1, 0});
+        auto mm = g->addOp<MatmulObj>(t3->getOutput(), t3->getOutput(),
+                                      nullptr);
+        g->optimize();
+
+        // t1 still feeds r2, so only t2 goes away; then t1 sinks below r2
+        EXPECT_EQ(g->getOperators().size(), 4u);
+        for (auto &op : OpVec{r1, mm})
+            EXPECT_TRUE(g->hasOperator(op));
+        EXPECT_EQ(r2->getOutput()->getSource()->getOpType(),
+                  OpType::Transpose);
+        EXPECT_EQ(r1->getInputs(0), i);
+        EXPECT_EQ(mm->getInputs(), (TensorVec{j, j}));
+        EXPECT_TRUE(mm->getTransA());
+        EXPECT_TRUE(mm->getTransB());
+        EXPECT_TRUE(g->checkValid());
+    }
+
+    TEST(Graph, OptimizeComposeTransposes)
+    {
+        auto g = checkOptimize({{2, 3, 4}}, [](Graph g, TensorVec in)
+                               {
+            auto t = g->addOp<TransposeObj>(in[0], nullptr, Shape{1, 2, 0});
+            t = g->addOp<TransposeObj>(t->getOutput(), nullptr,
+                                       Shape{1, 0, 2});
+            t = g->addOp<TransposeObj>(t->getOutput(), nullptr,
+                                       Shape{0, 2, 1});
+            return t->getOutput(); });
+        EXPECT_EQ(g->getOperators().size(), 1u);
+        auto perm = as<TransposeObj>(g->getOperators()[0])->getPermute();
+        EXPECT_EQ(perm, (vector<int>{2, 0, 1}));
+    }
+
+    TEST(Graph, OptimizeSinkTranspose)
+    {
+        // the bias is broadcast, so only it gets transposed back
+        auto g = checkOptimize(
+            {{2, 3, 4}, {4, 1, 3}}, [](Graph g, TensorVec in)
+            {
+                auto t = g->addOp<TransposeObj>(in[0], nullptr, Shape{2, 0, 1});
+                auto y = g->addOp<AddObj>(t->getOutput(), in[1], nullptr)
+                             ->getOutput();
+                y = g->addOp<ReluObj>(y, nullptr)->getOutput();
+                y = g->addOp<ClipObj>(y, nullptr, -1.f, 3.f)->getOutput();
+                return g->addOp<TransposeObj>(y, nullptr, Shape{1, 2, 0})
+                    ->getOutput(); });
+        // Add, Relu and Clip are then fused into one operator
+        EXPECT_EQ(g->getOperators().size(), 2u);
+        EXPECT_EQ(countOps(g, OpType::FusedElementWise), 1);
+        ASSERT_EQ(countOps(g, OpType::Transpose), 1);
+        for (auto &op : g->getOperators())
+        {
+            if (op->getOpType() == OpType::Transpose)
+            {
+                EXPECT_EQ(op->getInputs(0)->getDims(), (Shape{4, 1, 3}));
+            }
+        }
+
+        // a lower-rank bias keeps its shape when its dims stay trailing
+        g = checkOptimize({{2, 3, 4}, {4}}, [](Graph g, TensorVec in)
+                          {
+            auto t = g->addOp<TransposeObj>(in[0], nullptr, Shape{1, 0, 2});
+            auto y = g->addOp<MulObj>(in[1], t->getOutput(), nullptr)
+                         ->getOutput();
+            return g->addOp<TransposeObj>(y, nullptr, Shape{1, 0, 2})
+                ->getOutput(); });
+        EXPECT_EQ(g->getOperators().size(), 1u);
+        EXPECT_EQ(countOps(g, OpType::Transpose), 0);
+
+        // moving the bias dim out of the trailing block would need a reshape
+        g = checkOptimize({{2, 3, 4}, {2}}, [](Graph g, TensorVec in)
+                          {
+            auto t = g->addOp<TransposeObj>(in[0], nullptr, Shape{1, 2, 0});
+            return g->addOp<SubObj>(t->getOutput(), in[1], nullptr)
+                ->getOutput(); });
+        EXPECT_EQ(g->getOperators()[0]->getOpType(), OpType::Transpose);
+    }
+
+    TEST(Graph, OptimizeTransposeAroundMatmul)
+    {
+        auto g = checkOptimize({{5, 4}, {5, 3}}, [](Graph g, TensorVec in)
+                               {
+            auto t = g->addOp<TransposeObj>(in[0], nullptr, Shape{1, 0});
+            auto y = g->addOp<ReluObj>(t->getOutput(), nullptr)->getOutput();
+            y = g->addOp<MatmulObj>(y, in[1], nullptr)->getOutput();
+            return g->addOp<TransposeObj>(y, nullptr, Shape{1, 0})
+                ->getOutput(); });
+        ASSERT_EQ(g->getOperators().size(), 2u);
+        EXPECT_EQ(countOps(g, OpType::Relu), 1);
+        auto mm = as<MatmulObj>(g->getOperators()[1]);
+        ASSERT_TRUE(mm);
+        EXPECT_TRUE(mm->getTransA());
+        EXPECT_FALSE(mm->getTransB());
+    }
+
+    TEST(Graph, FoldConstants)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        checkTransform(
+            {{5, 4}, {3, 4}, {1}}, [](Graph g, TensorVec in)
+            {
+                // the weight goes through Transpose, Cast and a scale
+                auto y = g->addOp<TransposeObj>(in[1], nullptr, Shape{1, 0})
+                             ->getOutput();
+                y = g->addOp<CastObj>(y, nullptr, CastType::Float2Float16)
+                        ->getOutput();
+                y = g->addOp<CastObj>(y, nullptr, CastType::Float162Float)
+                        ->getOutput();
+                y = g->addOp<MulObj>(y, in[2], nullptr)->getOutput();
+                return g->addOp<MatmulObj>(in[0], y, nullptr)->getOutput(); },
+            [](Graph g, TensorVec in)
+            {
+                auto w = in[1], s = in[2];
+                w->setConstant();
+                s->setConstant();
+                w->setData(ScrambledGenerator());
+                s->setData(ScrambledGenerator());
+                g->optimize();
+                ASSERT_EQ(g->getOperators().size(), 1u);
+                auto b = g->getOperators()[0]->getInputs(1);
+                EXPECT_TRUE(b->isConstant());
+                EXPECT_FALSE(g->hasTensor(w));
+                EXPECT_FALSE(g->hasTensor(s));
+                EXPECT_EQ(g->getTensors().size(), 3u);
+            });
+
+        // an operator producing a graph output is not folded
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor c = g->addTensor({2, 3}, DataType::Float32);
+        c->setConstant();
+        g->addOp<ReluObj>(c, nullptr);
+        EXPECT_EQ(g->foldConstants(), 0u);
+        EXPECT_EQ(g->getOperators().size(), 1u);
+    }
+
+    TEST(Graph, EliminateCommonSubexpressions)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor w = g->addTensor({3, 4}, DataType::Float32);
+        // two identical Relu -> MatMul branches merge one after the other
+        auto a = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        auto b = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        a = g->addOp<MatmulObj>(a, w, nullptr)->getOutput();
+        b = g->addOp<MatmulObj>(b, w, nullptr)->getOutput();
+        // different attributes are kept apart
+        auto c = g->addOp<MatmulObj>(b, w, nullptr, false, true)->getOutput();
+        auto d = g->addOp<TransposeObj>(a, nullptr, Shape{1, 0})->getOutput();
+        auto e = g->addOp<TransposeObj>(c, nullptr, Shape{1, 0})->getOutput();
+        g->addOp<AddObj>(d, e, nullptr);
+        g->addOp<AddObj>(b, b, nullptr);
+        EXPECT_EQ(g->eliminateCommonSubexpressions(), 2u);
+        EXPECT_EQ(g->getOperators().size(), 7u);
+        EXPECT_TRUE(g->checkValid());
+        EXPECT_EQ(a->getTargets().size(), 4u);
+        EXPECT_FALSE(g->hasTensor(b));
+
+        // an operator producing a graph output is kept
+        Graph h = make_ref<GraphObj>(runtime);
+        Tensor y = h->addTensor({2, 3}, DataType::Float32);
+        auto r = h->addOp<ReluObj>(y, nullptr)->getOutput();
+        h->addOp<ReluObj>(y, nullptr);
+        h->addOp<ReluObj>(r, nullptr);
+        EXPECT_EQ(h->eliminateCommonSubexpressions(), 0u);
+    }
+
+    TEST(Graph, EliminateDeadCode)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor w = g->addTensor({3, 3}, DataType::Float32);
+        auto a = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        auto b = g->addOp<MatmulObj>(a, w, nullptr)->getOutput();
+        auto c = g->addOp<ReluObj>(b, nullptr)->getOutput();
+        // a dead branch reading a live tensor
+        auto d = g->addOp<CastObj>(b, nullptr, CastType::Float2Float16)->getOutput();
+        g->addOp<TransposeObj>(d, nullptr, Shape{1, 0});
+        // nothing is declared, so every unused tensor is an output
+        EXPECT_EQ(g->eliminateDeadCode(), 0u);
+
+        // b is declared too and stays persistent although Relu reads it
+        g->setOutputs({b, c});
+        EXPECT_EQ(g->eliminateDeadCode(), 2u);
+        EXPECT_EQ(g->getOperators().size(), 3u);
+        EXPECT_TRUE(g->checkValid());
+        EXPECT_EQ(g->getOutputs(), (TensorVec{b, c}));
+        EXPECT_TRUE(g->hasTensor(w));
+        g->dataMalloc();
+        EXPECT_NE(b->getRawDataPtr<void *>(), c->getRawDataPtr<void *>());
+        EXPECT_NE(b->getRawDataPtr<void *>(), a->getRawDataPtr<void *>());
+
+        // a graph input only read by dead operators goes away with them
+        g->setOutputs({a});
+        EXPECT_EQ(g->eliminateDeadCode(), 2u);
+        EXPECT_FALSE(g->hasTensor(w));
+        EXPECT_EQ(g->getOperators().size(), 1u);
+    }
+
+    TEST(Graph, OptimizeKeepsDeclaredOutputs)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto check = [](const Graph &g, const TensorVec &outputs)
+        {
+            g->setOutputs(outputs);
+            g->optimize();
+            EXPECT_TRUE(g->checkValid());
+            EXPECT_EQ(g->getOutputs(), outputs);
+            for (auto &output : outputs)
+                EXPECT_TRUE(g->hasTensor(output));
+            g->dataMalloc();
+        };
+        {
+            // not fused into the MatMul epilogue
+            Graph g = make_ref<GraphObj>(runtime);
+            auto a = g->addTensor({4, 4}, DataType::Float32);
+            auto b = g->addTensor({4, 4}, DataType::Float32);
+            auto y = g->addOp<MatmulObj>(a, b, nullptr)->getOutput();
+            auto z = g->addOp<ReluObj>(y, nullptr)->getOutput();
+            check(g, {y, z});
+        }
+        {
+            // the first Transpose stays although the pair cancels
+            Graph g = make_ref<GraphObj>(runtime);
+            auto x = g->addTensor({2, 3}, DataType::Float32);
+            auto m = g->addOp<TransposeObj>(x, nullptr, Shape{1, 0})
+                         ->getOutput();
+            auto t = g->addOp<TransposeObj>(m, nullptr, Shape{1, 0})
+                         ->getOutput();
+            auto r = g->addOp<ReluObj>(t, nullptr)->getOutput();
+            check(g, {m, r});
+        }
+        {
+            // not fused into the element-wise chain
+            Graph g = make_ref<GraphObj>(runtime);
+            auto x = g->addTensor({2, 3}, DataType::Float32);
+            auto r1 = g->addOp<ReluObj>(x, nullptr)->getOutput();
+            auto r2 = g->addOp<ClipObj>(r1, nullptr, -1.f, 1.f)->getOutput();
+            check(g, {r1, r2});
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "utils/graph_generator.h"
+#include <cstring>
+
+#include "test.h"
+
+namespace infini
+{
+    namespace
+    {
+        const GraphTopology topologies[] = {
+            GraphTopology::Chain, GraphTopology::FanOut,
+            GraphTopology::TransposeHeavy, GraphTopology::ConcatHeavy,
+            GraphTopology::Mixed};
+
+        // The number of operators on the longest path.
+        size_t depth(const Graph &g)
+        {
+            std::unordered_map<OperatorObj *, size_t> level;
+            size_t ret = 0;
+            for (auto &op : g->getOperators())
+            {
+                size_t d = 1;
+                for (auto &pre : op->getPredecessors())
+                    d = std::max(d, level.at(pre.get()) + 1);
+                level[op.get()] = d;
+                ret = std::max(ret, d);
+            }
+            return ret;
+        }
+    } // namespace
+
+    TEST(GraphGenerator, Valid)
+    {
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        for (auto topology : topologies)
+        {
+            GraphGeneratorConfig config;
+            config.topology = topology;
+            config.numOps = 500;
+            config.seed = 7;
+            Graph g = generateGraph(runtime, config);
+            // the same config gives the same graph
+            Graph again = generateGraph(runtime, config);
+            auto &ops = g->getOperators(), &opsAgain = again->getOperators();
+            ASSERT_EQ(ops.size(), opsAgain.size());
+            for (size_t i = 0; i < ops.size(); ++i)
+            {
+                EXPECT_EQ(ops[i]->getOpType(), opsAgain[i]->getOpType());
+                EXPECT_EQ(ops[i]->getOutput()->getDims(),
+                          opsAgain[i]->getOutput()->getDims());
+            }
+
+            EXPECT_TRUE(g->checkValid()) << graphTopologyToString(topology);
+            EXPECT_GE(g->getOperators().size(), 500u);
+            EXPECT_LE(g->getOperators().size(), 502u);
+            EXPECT_EQ(g->getInputs().size(), config.numInputs);
+            EXPECT_TRUE(g->topo_sort());
+            g->shape_infer();
+        }
+    }
+
+    TEST(GraphGenerator, Topology)
+    {
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        GraphGeneratorConfig config;
+        config.numOps = 1000;
+        config.topology = GraphTopology::Chain;
+        Graph chain = generateGraph(runtime, config);
+        EXPECT_GE(depth(chain), config.numOps - config.numInputs);
+        config.topology = GraphTopology::FanOut;
+        Graph fanOut = generateGraph(runtime, config);
+        EXPECT_LT(depth(fanOut), config.numOps / 10);
+
+        auto count = [](const Graph &g, OpType type)
+        {
+            size_t n = 0;
+            for (auto &op : g->getOperators())
+                n += op->getOpType() == type;
+            return n;
+        };
+        config.topology = GraphTopology::TransposeHeavy;
+        Graph transposes = generateGraph(runtime, config);
+        EXPECT_GT(count(transposes, OpType::Transpose), config.numOps / 2);
+        config.topology = GraphTopology::ConcatHeavy;
+        Graph concats = generateGraph(runtime, config);
+        EXPECT_GT(count(concats, OpType::Concat), config.numOps / 3);
+    }
+
+    TEST(GraphGenerator, Pipeline)
+    {
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        for (auto topology : topologies)
+        {
+            GraphGeneratorConfig config;
+            config.topology = topology;
+            config.numOps = 400;
+            // the plan of a large graph with heavy memory reuse must give
+            // the same results whether it runs in order or concurrently
+            Graph g = generateGraph(runtime, config);
+            g->dataMalloc();
+            for (auto &input : g->getInputs())
+                input->setData(ScrambledGenerator(1.f / 8));
+            runtime->setParallel(false);
+            runtime->run(g);
+            vector<vector<char>> expected;
+            for (auto &output : g->getOutputs())
+            {
+                auto ptr = output->getRawDataPtr<char *>();
+                expected.emplace_back(ptr, ptr + output->getBytes());
+            }
+            runtime->setParallel(true);
+            runtime->run(g);
+            runtime->setParallel(false);
+            auto outputs = g->getOutputs();
+            ASSERT_EQ(outputs.size(), expected.size());
+            for (size_t i = 0; i < outputs.size(); ++i)
+                EXPECT_EQ(std::memcmp(outputs[i]->getRawDataPtr<void *>(),
+                                      expected[i].data(), expected[i].size()),
+                          0)
+                    << graphTopologyToString(topology) << " output " << i;
+
+            // and the optimised graph is still valid and runs
+            Graph optimized = generateGraph(runtime, config);
+            optimized->optimize();
+            EXPECT_TRUE(optimized->checkValid());
+            EXPECT_LE(optimized->getOperators().size(),
+                      g->getOperators().size());
+            optimized->dataMalloc();
+            for (auto &input : optimized->getInputs())
+                input->setData(ScrambledGenerator(1.f / 8));
+            runtime->run(optimized);
+        }
+    }
+
+} // namespace infini
@@ -0,0 +1,213 @@
+#include "core/graph.h"
+#include "core/profiler.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/thread_pool.h"
+#include <chrono>
+
+#include "test.h"
+
+namespace infini
+{
+
+    TEST(Profiler, Records)
+    {
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({2, 8, 16}, DataType::Float32);
+        auto b = g->addTensor({16, 4}, DataType::Float32);
+        auto y = g->addOp<MatmulObj>(a, b, nullptr)->getOutput();
+        y = g->addOp<AddObj>(y, y, nullptr)->getOutput();
+        auto z = g->addOp<ReluObj>(y, nullptr)->getOutput();
+        g->addOp<TransposeObj>(z, nullptr, Shape{0, 2, 1});
+        g->dataMalloc();
+
+        // a given peak spares the measurement
+        auto profiler = make_ref<ProfilerObj>(MachinePeak{100, 10});
+        runtime->setProfiler(profiler);
+        runtime->run(g);
+        runtime->run(g);
+        runtime->setProfiler(nullptr);
+        runtime->run(g);
+
+        auto records = profiler->getRecords();
+        ASSERT_EQ(records.size(), 4u);
+        for (auto &r : records)
+        {
+            EXPECT_EQ(r.calls, 2u);
+            EXPECT_GT(r.seconds, 0);
+            if (r.opType == OpType::MatMul)
+            {
+                EXPECT_EQ(r.kernel, "MatmulBlocked_CPU");
+                EXPECT_EQ(r.flops, 2 * 2. * 2 * 8 * 4 * 16);
+                EXPECT_EQ(r.bytes, 2 * 4. * (2 * 8 * 16 + 16 * 4 + 2 * 8 * 4));
+            }
+            if (r.opType == OpType::Add)
+            {
+                EXPECT_EQ(r.flops, 2 * 64.);
+            }
+            if (r.opType == OpType::Transpose)
+            {
+                EXPECT_EQ(r.flops, 0);
+            }
+        }
+        for (size_t i = 1; i < records.size(); ++i)
+            EXPECT_GE(records[i - 1].seconds, records[i].seconds);
+
+        auto report = profiler->report();
+        EXPECT_NE(report.find("ridge 10.00 FLOP/B"), string::npos);
+        EXPECT_NE(report.find("addNaive_CPU"), string::npos);
+        EXPECT_NE(report.find("memory"), string::npos);
+        profiler->reset();
+        EXPECT_TRUE(profiler->getRecords().empty());
+    }
+
+    TEST(Profiler, ParallelRun)
+    {
+        // every recorded second is exclusive to one kernel on one thread,
+        // so the total fits in the time the pool had
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({128, 128}, DataType::Float32);
+        for (int i = 0; i < 8; ++i)
+        {
+            auto r = g->addOp<ReluObj>(x, nullptr)->getOutput();
+            g->addOp<MatmulObj>(r, x, nullptr);
+        }
+        g->dataMalloc();
+        auto profiler = make_ref<ProfilerObj>(MachinePeak{100, 10});
+        runtime->setProfiler(profiler);
+        runtime->setParallel(true);
+        auto start = std::chrono::steady_clock::now();
+        runtime->run(g);
+        std::chrono::duration<double> wall =
+            std::chrono::steady_clock::now() - start;
+        runtime->setParallel(false);
+        runtime->setProfiler(nullptr);
+
+        double total = 0;
+        for (auto &r : profiler->getRecords())
+        {
+            EXPECT_EQ(r.calls, 8u);
+            total += r.seconds;
+        }
+        EXPECT_LE(total, wall.count() * ThreadPool::getInstance().size());
+    }
+
+    TEST(Profiler, HardwareCounters)
+    {
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({64, 64}, DataType::Float32);
+        g->addOp<TransposeObj>(a, nullptr, Shape{1, 0});
+        g->dataMalloc();
+
+        auto profiler = make_ref<ProfilerObj>(MachinePeak{100, 10});
+        profiler->setHardwareCounters(true);
+        runtime->setProfiler(profiler);
+        runtime->run(g);
+        runtime->setProfiler(nullptr);
+
+        // counters may be forbidden here; then the report says so instead
+        auto &counters = PerfCounters::forThisThread();
+        auto records = profiler->getRecords();
+        ASSERT_EQ(records.size(), 1u);
+        auto report = profiler->report();
+        // a group the PMU never scheduled gives no counts at all
+        for (size_t i = 0; i < NUM_PERF_EVENTS; ++i)
+            EXPECT_LE(records[0].eventCalls[i],
+                      counters.available(PerfEvent(i)) ? 1u : 0u);
+        if (counters.anyAvailable())
+        {
+            EXPECT_NE(report.find("LLC miss/KB"), string::npos);
+        }
+        else
+        {
+            EXPECT_NE(report.find("Hardware counters unavailable"),
+                      string::npos);
+        }
+        if (counters.available(PerfEvent::Instructions))
+        {
+            EXPECT_GT(records[0].events[size_t(PerfEvent::Instructions)], 0);
+        }
+    }
+
+    TEST(Profiler, PartialCounters)
+    {
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({4, 4}, DataType::Float32);
+        g->addOp<ReluObj>(a, nullptr);
+        g->dataMalloc();
+        g->compile();
+        auto &instr = g->getPlan()[0];
+
+        PerfSample events;
+        events.valid.fill(true);
+        events.values.fill(10);
+        auto profiler = make_ref<ProfilerObj>(MachinePeak{100, 10});
+        profiler->setHardwareCounters(true);
+        profiler->record(instr, 1e-6, events);
+        EXPECT_EQ(profiler->report().find("partial"), string::npos);
+        // calls without counts do not make a row partial
+        profiler->record(instr, 1e-6, {}, true);
+        EXPECT_EQ(profiler->getRecords()[0].partialCalls, 0u);
+        profiler->record(instr, 1e-6, events, true);
+        EXPECT_EQ(profiler->getRecords()[0].partialCalls, 1u);
+        auto report = profiler->report();
+        EXPECT_NE(report.find("reluNaive_CPU*"), string::npos);
+        EXPECT_NE(report.find("* partial"), string::npos);
+    }
+
+    TEST(Profiler, ZeroTime)
+    {
+        // a clock too coarse for the kernel gives no rate, not inf or nan
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({4, 4}, DataType::Float32);
+        g->addOp<ReluObj>(a, nullptr);
+        g->dataMalloc();
+        g->compile();
+        auto profiler = make_ref<ProfilerObj>(MachinePeak{100, 10});
+        profiler->record(g->getPlan()[0], 0);
+        auto report = profiler->report();
+        EXPECT_EQ(report.find("inf"), string::npos);
+        EXPECT_EQ(report.find("nan"), string::npos);
+    }
+
+    TEST(Profiler, PerfSampleScaling)
+    {
+        PerfSample before, after;
+        before.valid.fill(true);
+        after.valid.fill(true);
+        after.valid[size_t(PerfEvent::LLCMisses)] = false;
+        before.values[size_t(PerfEvent::Cycles)] = 100;
+        after.values[size_t(PerfEvent::Cycles)] = 300;
+        before.timeEnabled = before.timeRunning = 1000;
+        // the group ran for half of the interval
+        after.timeEnabled = 3000;
+        after.timeRunning = 2000;
+        auto delta = after - before;
+        EXPECT_TRUE(delta.valid[size_t(PerfEvent::Cycles)]);
+        EXPECT_EQ(delta.values[size_t(PerfEvent::Cycles)], 400u);
+        EXPECT_FALSE(delta.valid[size_t(PerfEvent::LLCMisses)]);
+
+        // and not at all
+        after.timeRunning = 1000;
+        delta = after - before;
+        for (size_t i = 0; i < NUM_PERF_EVENTS; ++i)
+            EXPECT_FALSE(delta.valid[i]);
+    }
+
+    TEST(Profiler, MachinePeak)
+    {
+        auto &peak = MachinePeak::measure();
+        EXPECT_GT(peak.gflops, 0);
+        EXPECT_GT(peak.gbps, 0);
+        EXPECT_EQ(&peak, &MachinePeak::measure());
+    }
+
+} // namespace infini
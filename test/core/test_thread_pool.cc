@@ -0,0 +1,87 @@
+#include "core/data_type.h"
+#include "utils/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+
+#include "test.h"
+
+namespace infini {
+
+TEST(ThreadPool, ParallelFor) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+    for (size_t n : {0, 1, 3, 1000}) {
+        vector<int> hits(n, 0);
+        pool.parallelFor(n, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                ++hits[i];
+        });
+        EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), (long)n);
+    }
+}
+
+TEST(ThreadPool, Nested) {
+    // a loop forked from inside a range is run by the thread that forks
+    // it, so even a pool without workers finishes them
+    for (size_t threads : {1, 3}) {
+        ThreadPool pool(threads);
+        std::atomic<size_t> sum(0);
+        pool.parallelFor(8, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                pool.parallelFor(100, [&](size_t b, size_t e) {
+                    for (size_t j = b; j < e; ++j)
+                        sum += i * 100 + j;
+                });
+        });
+        EXPECT_EQ(sum.load(), 800u * 799 / 2);
+    }
+}
+
+TEST(ThreadPool, SharedLoops) {
+    auto slow = [](size_t, size_t) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    };
+    // without workers the calling thread runs every range itself
+    ThreadPool alone(1);
+    size_t before = ThreadPool::sharedLoops();
+    alone.parallelFor(8, slow);
+    EXPECT_EQ(ThreadPool::sharedLoops(), before);
+    // ranges slow enough that the workers take some while it sleeps
+    ThreadPool pool(4);
+    pool.parallelFor(8, slow);
+    EXPECT_EQ(ThreadPool::sharedLoops(), before + 1);
+}
+
+TEST(ThreadPool, NoTaskInsideLoop) {
+    // a thread waiting for its loop runs none of the queued tasks, which
+    // would nest them inside the loop
+    for (size_t threads : {1, 3}) {
+        ThreadPool pool(threads);
+        auto caller = std::this_thread::get_id();
+        bool inLoop = false;
+        std::atomic<int> done(0), nested(0);
+        for (int i = 0; i < 16; ++i)
+            pool.submit([&]() {
+                nested += std::this_thread::get_id() == caller && inLoop;
+                ++done;
+            });
+        inLoop = true;
+        pool.parallelFor(16, [&](size_t, size_t) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+        inLoop = false;
+        pool.waitUntil([&]() { return done.load() == 16; });
+        EXPECT_EQ(nested.load(), 0);
+    }
+}
+
+TEST(ThreadPool, Submit) {
+    ThreadPool pool(4);
+    std::atomic<int> done(0);
+    for (int i = 0; i < 64; ++i)
+        pool.submit([&]() { ++done; });
+    pool.waitUntil([&]() { return done.load() == 64; });
+    EXPECT_EQ(done.load(), 64);
+}
+
+} // namespace infini
@@ -0,0 +1,80 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "core/tracer.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+#include <cstdio>
+#include <fstream>
+
+#include "test.h"
+
+namespace infini
+{
+
+    static size_t count(const string &s, const string &what)
+    {
+        size_t n = 0;
+        for (auto pos = s.find(what); pos != string::npos;
+             pos = s.find(what, pos + 1))
+            ++n;
+        return n;
+    }
+
+    TEST(Tracer, JsonQuote)
+    {
+        EXPECT_EQ(jsonQuote("MatMul"), "\"MatMul\"");
+        EXPECT_EQ(jsonQuote("a\"b\\c"), "\"a\\\"b\\\\c\"");
+        EXPECT_EQ(jsonQuote("x\ny\t\x1f"), "\"x\\u000ay\\u0009\\u001f\"");
+    }
+
+    TEST(Tracer, Timeline)
+    {
+        auto runtime = NativeCpuRuntimeObj::getInstance();
+        auto tracer = make_ref<TracerObj>();
+        runtime->setTracer(tracer);
+
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({2, 8, 16}, DataType::Float32);
+        auto b = g->addTensor({16, 4}, DataType::Float32);
+        auto y = g->addOp<MatmulObj>(a, b, nullptr)->getOutput();
+        auto r1 = g->addOp<ReluObj>(y, nullptr)->getOutput();
+        auto r2 = g->addOp<ReluObj>(y, nullptr)->getOutput();
+        g->addOp<AddObj>(r1, r2, nullptr);
+        g->dataMalloc();
+        // 3 resident and 3 intermediate tensors are placed, the intermediates
+        // released again; each with an instant and a counter event
+        EXPECT_EQ(tracer->size(), 2u * (6 + 3));
+
+        runtime->setParallel(true);
+        runtime->run(g);
+        runtime->setParallel(false);
+        runtime->setTracer(nullptr);
+        runtime->run(g);
+
+        auto json = tracer->toJson();
+        EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0),
+                  0u);
+        EXPECT_EQ(count(json, "\"ph\":\"X\""), 4u);
+        EXPECT_EQ(count(json, "\"name\":\"Relu\""), 2u);
+        EXPECT_EQ(count(json, "\"name\":\"alloc\""), 6u);
+        EXPECT_EQ(count(json, "\"name\":\"free\""), 3u);
+        EXPECT_EQ(count(json, "\"name\":\"arena\""), 9u);
+        EXPECT_NE(json.find("\"kernel\":\"MatmulBlocked_CPU\",\"inputs\":"
+                            "[\"[2,8,16]\",\"[16,4]\"]"),
+                  string::npos);
+        EXPECT_NE(json.find("\"thread_name\""), string::npos);
+
+        string path = "test_tracer.json";
+        tracer->save(path);
+        std::ifstream file(path);
+        std::stringstream saved;
+        saved << file.rdbuf();
+        EXPECT_EQ(saved.str(), json);
+        std::remove(path.c_str());
+
+        tracer->clear();
+        EXPECT_EQ(tracer->size(), 0u);
+    }
+
+} // namespace infini
@@ -0,0 +1,186 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/unary.h"
+#include "utils/half.h"
+
+#include "test.h"
+#include <cmath>
+#include <limits>
+
+namespace infini {
+
+// Runs one Cast over `input` and returns the raw output elements. Inputs are
+// longer than a vector so both the vector loop and the tail are covered.
+template <typename To, typename From>
+static vector<To> runCast(CastType type, DataType dtype,
+                          const vector<From> &input) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({(int)input.size()}, dtype);
+    auto op = g->addOp<CastObj>(x, nullptr, type);
+    g->dataMalloc();
+    x->setData([&](void *data, size_t size, DataType) {
+        std::memcpy(data, input.data(), size * sizeof(From));
+    });
+    runtime->run(g);
+    auto out = op->getOutput()->getRawDataPtr<To *>();
+    return vector<To>(out, out + input.size());
+}
+
+template <typename T> static vector<T> repeat(vector<T> v, size_t times) {
+    vector<T> ret;
+    for (size_t i = 0; i < times; ++i)
+        ret.insert(ret.end(), v.begin(), v.end());
+    return ret;
+}
+
+TEST(Cast, NativeCpuFloatToInt) {
+    const float nan = std::nanf(""), inf = INFINITY;
+    vector<float> in = {-inf, -1e20f, -40000.f, -200.5f, -3.7f, -0.f,
+                        nan,  2.9f,   127.9f,   40000.f, 3e9f,  inf};
+    in = repeat(in, 3);
+    EXPECT_EQ(runCast<int8_t>(CastType::Float2Int8, DataType::Float32, in),
+              repeat(vector<int8_t>{-128, -128, -128, -128, -3, 0, 0, 2,
+                                    127, 127, 127, 127},
+                     3));
+    EXPECT_EQ(runCast<int16_t>(CastType::Float2Int16, DataType::Float32, in),
+              repeat(vector<int16_t>{-32768, -32768, -32768, -200, -3, 0, 0,
+                                     2, 127, 32767, 32767, 32767},
+                     3));
+    const int32_t i32Min = INT32_MIN, i32Max = INT32_MAX;
+    EXPECT_EQ(runCast<int32_t>(CastType::Float2Int32, DataType::Float32, in),
+              repeat(vector<int32_t>{i32Min, i32Min, -40000, -200, -3, 0, 0,
+                                     2, 127, 40000, i32Max, i32Max},
+                     3));
+    const int64_t i64Min = INT64_MIN, i64Max = INT64_MAX;
+    EXPECT_EQ(runCast<int64_t>(CastType::Float2Int64, DataType::Float32, in),
+              repeat(vector<int64_t>{i64Min, i64Min, -40000, -200, -3, 0, 0,
+                                     2, 127, 40000, 3000000000, i64Max},
+                     3));
+}
+
+TEST(Cast, NativeCpuIntegers) {
+    vector<int32_t> i32 = repeat(
+        vector<int32_t>{INT32_MIN, -70000, -129, -5, 0, 7, 128, 70000}, 3);
+    EXPECT_EQ(runCast<int8_t>(CastType::Int322Int8, DataType::Int32, i32),
+              repeat(vector<int8_t>{-128, -128, -128, -5, 0, 7, 127, 127}, 3));
+    EXPECT_EQ(
+        runCast<int16_t>(CastType::Int322Int16, DataType::Int32, i32),
+        repeat(vector<int16_t>{-32768, -32768, -129, -5, 0, 7, 128, 32767},
+               3));
+    EXPECT_EQ(runCast<int64_t>(CastType::Int322Int64, DataType::Int32, i32),
+              vector<int64_t>(i32.begin(), i32.end()));
+    EXPECT_EQ(runCast<float>(CastType::Int322Float, DataType::Int32, i32),
+              vector<float>(i32.begin(), i32.end()));
+
+    vector<int16_t> i16 = repeat(vector<int16_t>{-32768, -3, 0, 32767}, 5);
+    EXPECT_EQ(runCast<int32_t>(CastType::Int162Int32, DataType::Int16, i16),
+              vector<int32_t>(i16.begin(), i16.end()));
+    EXPECT_EQ(runCast<float>(CastType::Int162Float, DataType::Int16, i16),
+              vector<float>(i16.begin(), i16.end()));
+
+    vector<int8_t> i8 = repeat(vector<int8_t>{-128, -1, 0, 127}, 5);
+    EXPECT_EQ(runCast<int16_t>(CastType::Int82Int16, DataType::Int8, i8),
+              vector<int16_t>(i8.begin(), i8.end()));
+    EXPECT_EQ(runCast<int32_t>(CastType::Int82Int32, DataType::Int8, i8),
+              vector<int32_t>(i8.begin(), i8.end()));
+    EXPECT_EQ(runCast<float>(CastType::Int82Float, DataType::Int8, i8),
+              vector<float>(i8.begin(), i8.end()));
+
+    vector<uint8_t> u8 = repeat(vector<uint8_t>{0, 1, 128, 255}, 5);
+    EXPECT_EQ(runCast<int32_t>(CastType::Uint82Int32, DataType::UInt8, u8),
+              vector<int32_t>(u8.begin(), u8.end()));
+    EXPECT_EQ(runCast<int64_t>(CastType::Uint82Int64, DataType::UInt8, u8),
+              vector<int64_t>(u8.begin(), u8.end()));
+    EXPECT_EQ(runCast<float>(CastType::Uint82Float, DataType::UInt8, u8),
+              vector<float>(u8.begin(), u8.end()));
+
+    vector<uint32_t> u32 =
+        repeat(vector<uint32_t>{0, 1, 0x80000000u, UINT32_MAX}, 5);
+    EXPECT_EQ(runCast<int64_t>(CastType::Uint322Int64, DataType::UInt32, u32),
+              vector<int64_t>(u32.begin(), u32.end()));
+
+    vector<int64_t> i64 = repeat(
+        vector<int64_t>{INT64_MIN, -5000000000, -1, 0, 3, 5000000000,
+                        (int64_t)1 << 40, INT64_MAX},
+        3);
+    EXPECT_EQ(runCast<int32_t>(CastType::Int642Int32, DataType::Int64, i64),
+              repeat(vector<int32_t>{INT32_MIN, INT32_MIN, -1, 0, 3, INT32_MAX,
+                                     INT32_MAX, INT32_MAX},
+                     3));
+    EXPECT_EQ(runCast<uint32_t>(CastType::Int642Uint32, DataType::Int64, i64),
+              repeat(vector<uint32_t>{0, 0, 0, 0, 3, UINT32_MAX, UINT32_MAX,
+                                      UINT32_MAX},
+                     3));
+    vector<float> i64AsFloat;
+    for (auto v : i64)
+        i64AsFloat.emplace_back(float(v));
+    EXPECT_EQ(runCast<float>(CastType::Int642Float, DataType::Int64, i64),
+              i64AsFloat);
+}
+
+TEST(Cast, NativeCpuFloat16) {
+    vector<float> in = {1.f,        -2.f,       0.1f,
+                        65504.f,    65519.f,    65520.f,
+                        1e-8f,      0x1.0p-24f, 0x1.8p-24f,
+                        0x1.0p-14f, INFINITY,   -0.f,
+                        1.f + 0x1.0p-11f, // Tie, rounds down to even.
+                        1.f + 0x1.8p-10f}; // Tie, rounds up to even.
+    in = repeat(in, 2);
+    vector<uint16_t> bits = {0x3C00, 0xC000, 0x2E66, 0x7BFF, 0x7BFF,
+                             0x7C00, 0x0000, 0x0001, 0x0002, 0x0400,
+                             0x7C00, 0x8000, 0x3C00, 0x3C02};
+    auto out = runCast<fp16_t>(CastType::Float2Float16, DataType::Float32, in);
+    for (size_t i = 0; i < in.size(); ++i)
+        EXPECT_EQ(out[i].bits, bits[i % bits.size()]) << in[i];
+    EXPECT_TRUE(std::isnan(
+        fp16ToFloat(runCast<fp16_t>(CastType::Float2Float16,
+                                    DataType::Float32,
+                                    vector<float>(9, std::nanf("")))[8])));
+
+    // Every non-NaN half survives a round trip through float.
+    vector<fp16_t> all;
+    for (uint32_t b = 0; b < 0x10000; ++b)
+        if ((b & 0x7C00) != 0x7C00 || (b & 0x3FF) == 0)
+            all.push_back({uint16_t(b)});
+    auto wide = runCast<float>(CastType::Float162Float, DataType::Float16, all);
+    auto back =
+        runCast<fp16_t>(CastType::Float2Float16, DataType::Float32, wide);
+    for (size_t i = 0; i < all.size(); ++i) {
+        ASSERT_EQ(floatToFp16(fp16ToFloat(all[i])).bits, all[i].bits);
+        ASSERT_EQ(wide[i], fp16ToFloat(all[i]));
+        ASSERT_EQ(back[i].bits, all[i].bits);
+    }
+}
+
+TEST(Cast, NativeCpuBFloat16) {
+    vector<float> in = {1.f,
+                        -2.5f,
+                        0x1.01p0f, // Tie, rounds down to even.
+                        0x1.03p0f, // Tie, rounds up to even.
+                        0x1.0101p0f,
+                        3.4e38f,
+                        INFINITY,
+                        std::nanf("")};
+    in = repeat(in, 3);
+    auto out = runCast<bf16_t>(CastType::Float2BFloat16, DataType::Float32, in);
+    vector<uint16_t> bits = {0x3F80, 0xC020, 0x3F80, 0x3F82,
+                             0x3F81, 0x7F80, 0x7F80};
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (std::isnan(in[i]))
+            EXPECT_TRUE(std::isnan(bf16ToFloat(out[i])));
+        else
+            EXPECT_EQ(out[i].bits, bits[i % 8]) << in[i];
+    }
+
+    auto wide = runCast<float>(CastType::BFloat162Float, DataType::BFloat16,
+                               repeat(vector<bf16_t>{{0x3F80}, {0xC020}}, 5));
+    EXPECT_EQ(wide, repeat(vector<float>{1.f, -2.5f}, 5));
+}
+
+TEST(Cast, NativeCpuFloat2Float) {
+    vector<float> in = {1.5f, -0.f, INFINITY, 3e-40f, 7.f};
+    EXPECT_EQ(runCast<float>(CastType::Float2Float, DataType::Float32, in), in);
+}
+
+} // namespace infini
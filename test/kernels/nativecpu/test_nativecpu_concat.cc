@@ -1,6 +1,7 @@
 #include "core/graph.h"
 #include "core/runtime.h"
 #include "operators/concat.h"
+#include "utils/simd.h"
 
 #include "test.h"
 
@@ -25,4 +26,73 @@ TEST(Concat, NativeCpu) {
                       6, 7, 8, 1, 1, 1, 9, 10, 11, 1, 1, 1}));
 }
 
+// Blocks larger than one copy piece along with an outer dimension, and
+// inputs of other element types.
+TEST(Concat, NativeCpuLargeBlocks) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+
+    auto t1 = g->addTensor({3, 9000}, DataType::Float32);
+    auto t2 = g->addTensor({3, 12345}, DataType::Float32);
+    auto op = g->addOp<ConcatObj>(TensorVec{t1, t2}, nullptr, -1);
+    auto u1 = g->addTensor({1, 3}, DataType::Int64);
+    auto u2 = g->addTensor({2, 3}, DataType::Int64);
+    auto opInt = g->addOp<ConcatObj>(TensorVec{u1, u2}, nullptr, 0);
+    g->dataMalloc();
+    t1->setData(IncrementalGenerator());
+    t2->setData(OneGenerator());
+    auto int64Iota = [](void *data, size_t size, DataType) {
+        for (size_t i = 0; i < size; ++i)
+            static_cast<int64_t *>(data)[i] = i;
+    };
+    u1->setData(int64Iota);
+    u2->setData(int64Iota);
+
+    runtime->run(g);
+    vector<float> ans;
+    for (int r = 0; r < 3; ++r) {
+        for (int i = 0; i < 9000; ++i)
+            ans.emplace_back(r * 9000 + i);
+        ans.insert(ans.end(), 12345, 1);
+    }
+    EXPECT_TRUE(op->getOutput()->equalData(ans));
+    EXPECT_TRUE(
+        opInt->getOutput()->equalData(vector<int64_t>{0, 1, 2, 0, 1, 2, 3, 4, 5}));
+}
+
+// A zero-sized dimension at or after the axis leaves nothing to copy.
+TEST(Concat, NativeCpuEmpty) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+
+    auto t1 = g->addTensor({2, 0}, DataType::Float32);
+    auto t2 = g->addTensor({3, 0}, DataType::Float32);
+    auto op = g->addOp<ConcatObj>(TensorVec{t1, t2}, nullptr, 0);
+    g->dataMalloc();
+
+    runtime->run(g);
+    EXPECT_EQ(op->getOutput()->getDims(), (Shape{5, 0}));
+    EXPECT_EQ(op->getOutput()->size(), 0u);
+}
+
+// Non-temporal copies must handle every destination alignment and length.
+TEST(Simd, StreamCopy) {
+    vector<char> src(300), dst(320), ref(320);
+    for (size_t i = 0; i < src.size(); ++i)
+        src[i] = char(i * 7 + 1);
+    for (auto isa : {CpuIsa::Generic, CpuIsa::SSE42, CpuIsa::AVX2}) {
+        if (isa > getCpuIsa())
+            break;
+        SCOPED_TRACE(cpuIsaToString(isa));
+        for (size_t offset : {0, 1, 13, 31})
+            for (size_t bytes : {0, 5, 32, 63, 64, 287}) {
+                std::fill(dst.begin(), dst.end(), 0);
+                std::fill(ref.begin(), ref.end(), 0);
+                selectStreamCopy(isa)(dst.data() + offset, src.data(), bytes);
+                std::memcpy(ref.data() + offset, src.data(), bytes);
+                EXPECT_EQ(dst, ref);
+            }
+    }
+}
+
 } // namespace infini
@@ -41,4 +41,40 @@ TEST(ElementWise, NativeCpu) {
         Shape{2, 1, 1}, ExpectOutput{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11});
 }
 
+TEST(ElementWise, NativeCpuBroadcast) {
+    // same shape
+    testElementWiseNativeCpu<AddObj>(IncrementalGenerator(),
+                                     IncrementalGenerator(), Shape{2, 3},
+                                     Shape{2, 3}, ExpectOutput{0, 2, 4, 6, 8, 10});
+    // scalar
+    testElementWiseNativeCpu<SubObj>(IncrementalGenerator(), OneGenerator(),
+                                     Shape{2, 3}, Shape{1},
+                                     ExpectOutput{-1, 0, 1, 2, 3, 4});
+    // row
+    testElementWiseNativeCpu<AddObj>(IncrementalGenerator(),
+                                     IncrementalGenerator(), Shape{2, 3},
+                                     Shape{3}, ExpectOutput{0, 2, 4, 3, 5, 7});
+    // column
+    testElementWiseNativeCpu<AddObj>(IncrementalGenerator(),
+                                     IncrementalGenerator(), Shape{2, 3},
+                                     Shape{2, 1}, ExpectOutput{0, 1, 2, 4, 5, 6});
+    // both inputs broadcast
+    testElementWiseNativeCpu<AddObj>(
+        IncrementalGenerator(), IncrementalGenerator(), Shape{2, 1, 3},
+        Shape{1, 2, 1}, ExpectOutput{0, 1, 2, 1, 2, 3, 3, 4, 5, 4, 5, 6});
+
+    // large enough to be split across chunks
+    Shape shapeA{3, 70, 2, 300}, shapeB{70, 1, 300};
+    ExpectOutput ans;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 70; ++j)
+            for (int k = 0; k < 2; ++k)
+                for (int l = 0; l < 300; ++l)
+                    ans.emplace_back(((i * 70 + j) * 2 + k) * 300 + l -
+                                     (j * 300 + l));
+    testElementWiseNativeCpu<SubObj>(IncrementalGenerator(),
+                                     IncrementalGenerator(), shapeA, shapeB,
+                                     ans);
+}
+
 } // namespace infini
@@ -0,0 +1,102 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+// The fused kernel computes every step in the storage type of the unfused
+// one, so the results match exactly.
+static Graph testFusion(const vector<Shape> &shapes,
+                        const std::function<Tensor(Graph, TensorVec)> &build) {
+    return checkOptimize(shapes, build, 0, ScrambledGenerator(0.37f));
+}
+
+TEST(FusedElementWise, AfterMatmul) {
+    // a scale is not a MatMul epilogue, so the chain is fused on its own
+    auto g = testFusion({{33, 17}, {17, 40}, {40}}, [](Graph g, auto in) {
+        auto y = g->addOp<MatmulObj>(in[0], in[1], nullptr)->getOutput();
+        y = g->addOp<MulObj>(y, in[2], nullptr)->getOutput();
+        y = g->addOp<AddObj>(y, in[2], nullptr)->getOutput();
+        return g->addOp<ClipObj>(y, nullptr, std::nullopt, 1.5f)->getOutput();
+    });
+    EXPECT_EQ(g->getOperators().size(), 2u);
+    EXPECT_EQ(countOps(g, OpType::FusedElementWise), 1);
+    // only the graph inputs and outputs and the MatMul result are left
+    EXPECT_EQ(g->getTensors().size(), 5u);
+}
+
+TEST(FusedElementWise, Broadcast) {
+    // inputs broadcast along different dims and reused by several steps;
+    // the last dim spans several blocks and a partial one
+    auto g = testFusion(
+        {{2, 3, 700}, {3, 1}, {700}, {}}, [](Graph g, auto in) {
+            auto y = g->addOp<AddObj>(in[0], in[1], nullptr)->getOutput();
+            y = g->addOp<MulObj>(y, in[0], nullptr)->getOutput();
+            y = g->addOp<SubObj>(in[2], y, nullptr)->getOutput();
+            y = g->addOp<DivObj>(y, in[3], nullptr)->getOutput();
+            return g->addOp<MulObj>(y, y, nullptr)->getOutput();
+        });
+    ASSERT_EQ(g->getOperators().size(), 1u);
+    EXPECT_EQ(g->getOperators()[0]->getInputs().size(), 4u);
+
+    // large enough to run in parallel
+    testFusion({{64, 1024}, {64, 1}}, [](Graph g, auto in) {
+        auto y = g->addOp<SubObj>(in[0], in[1], nullptr)->getOutput();
+        return g->addOp<ReluObj>(y, nullptr)->getOutput();
+    });
+}
+
+TEST(FusedElementWise, HalfSteps) {
+    // every step rounds to its own data type, like the unfused kernels
+    for (auto castType : {CastType::Float2Float16, CastType::Float2BFloat16}) {
+        auto back = castType == CastType::Float2Float16
+                        ? CastType::Float162Float
+                        : CastType::BFloat162Float;
+        auto g = testFusion({{5, 300}, {300}}, [&](Graph g, auto in) {
+            auto a = g->addOp<CastObj>(in[0], nullptr, castType)->getOutput();
+            auto b = g->addOp<CastObj>(in[1], nullptr, castType)->getOutput();
+            auto y = g->addOp<MulObj>(a, b, nullptr)->getOutput();
+            y = g->addOp<ClipObj>(y, nullptr, -0.3f, 0.7f)->getOutput();
+            y = g->addOp<CastObj>(y, nullptr, back)->getOutput();
+            return g->addOp<MulObj>(y, in[1], nullptr)->getOutput();
+        });
+        // the Cast of the broadcast input stays on its own
+        EXPECT_EQ(g->getOperators().size(), 2u);
+        EXPECT_EQ(countOps(g, OpType::FusedElementWise), 1);
+    }
+}
+
+TEST(FusedElementWise, SharedIntermediate) {
+    // an intermediate also read by another operator must still be written
+    // out; once both its element-wise readers are merged it is fused too
+    auto g = testFusion({{6, 6}}, [](Graph g, auto in) {
+        auto y = g->addOp<ReluObj>(in[0], nullptr)->getOutput();
+        auto a = g->addOp<AddObj>(y, in[0], nullptr)->getOutput();
+        auto b = g->addOp<MatmulObj>(y, in[0], nullptr)->getOutput();
+        return g->addOp<MulObj>(a, b, nullptr)->getOutput();
+    });
+    EXPECT_EQ(g->getOperators().size(), 3u);
+    EXPECT_EQ(countOps(g, OpType::Relu), 1);
+    g = testFusion({{4, 6}}, [](Graph g, auto in) {
+        auto y = g->addOp<ReluObj>(in[0], nullptr)->getOutput();
+        auto a = g->addOp<AddObj>(y, in[0], nullptr)->getOutput();
+        auto b = g->addOp<SubObj>(y, in[0], nullptr)->getOutput();
+        return g->addOp<MulObj>(a, b, nullptr)->getOutput();
+    });
+    EXPECT_EQ(g->getOperators().size(), 1u);
+
+    // UInt32 is not fused
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph h = make_ref<GraphObj>(runtime);
+    auto x = h->addTensor({4, 6}, DataType::UInt32);
+    auto y = h->addOp<AddObj>(x, x, nullptr)->getOutput();
+    h->addOp<ReluObj>(y, nullptr);
+    h->optimize();
+    EXPECT_EQ(countOps(h, OpType::FusedElementWise), 0);
+}
+
+} // namespace infini
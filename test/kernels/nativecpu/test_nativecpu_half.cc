@@ -0,0 +1,99 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+// Integers in [-3, 3] are exact in both 16-bit formats, so only the rounding
+// of the outputs differs from the Float32 graph.
+static void smallIntGenerator(void *data, size_t size, DataType dtype) {
+    IT_ASSERT(dtype == DataType::Float32);
+    auto ptr = reinterpret_cast<float *>(data);
+    for (size_t i = 0; i < size; ++i)
+        ptr[i] = float(int(i % 7) - 3);
+}
+
+using BuildFunc = std::function<Tensor(Graph, TensorVec)>;
+
+// Runs `build` on Float32 inputs, and again with every input cast to `dtype`
+// and the output cast back to Float32, then compares the two outputs.
+static void testAgainstFloat(DataType dtype, const vector<Shape> &shapes,
+                             const BuildFunc &build) {
+    bool isFp16 = dtype == DataType::Float16;
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    TensorVec inputs, narrowed;
+    for (auto &shape : shapes) {
+        auto input = g->addTensor(shape, DataType::Float32);
+        inputs.emplace_back(input);
+        narrowed.emplace_back(
+            g->addOp<CastObj>(input, nullptr,
+                              isFp16 ? CastType::Float2Float16
+                                     : CastType::Float2BFloat16)
+                ->getOutput());
+    }
+    auto ref = build(g, inputs);
+    auto half = build(g, narrowed);
+    EXPECT_EQ(half->getDType(), dtype);
+    auto widened = g->addOp<CastObj>(half, nullptr,
+                                     isFp16 ? CastType::Float162Float
+                                            : CastType::BFloat162Float)
+                       ->getOutput();
+    g->dataMalloc();
+    for (auto &input : inputs)
+        input->setData(smallIntGenerator);
+    runtime->run(g);
+    EXPECT_TRUE(widened->equalData(ref, isFp16 ? 1e-3 : 8e-3));
+}
+
+class HalfStorage : public testing::TestWithParam<DataType> {};
+
+TEST_P(HalfStorage, ElementWise) {
+    testAgainstFloat(GetParam(), {{2, 3, 300}, {3, 1}}, [](Graph g, auto in) {
+        auto sum = g->addOp<AddObj>(in[0], in[1], nullptr)->getOutput();
+        auto prod = g->addOp<MulObj>(sum, in[0], nullptr)->getOutput();
+        return g->addOp<SubObj>(prod, in[1], nullptr)->getOutput();
+    });
+}
+
+TEST_P(HalfStorage, Unary) {
+    testAgainstFloat(GetParam(), {{5, 77}}, [](Graph g, auto in) {
+        auto relu = g->addOp<ReluObj>(in[0], nullptr)->getOutput();
+        return g->addOp<ClipObj>(relu, nullptr, 0.5f, 2.f)->getOutput();
+    });
+}
+
+TEST_P(HalfStorage, DataMovement) {
+    testAgainstFloat(
+        GetParam(), {{2, 3, 20, 9}, {2, 3, 20, 4}}, [](Graph g, auto in) {
+            auto cat = g->addOp<ConcatObj>(in, nullptr, 3)->getOutput();
+            return g
+                ->addOp<TransposeObj>(cat, nullptr, vector<int>{0, 3, 2, 1})
+                ->getOutput();
+        });
+}
+
+TEST_P(HalfStorage, Matmul) {
+    testAgainstFloat(GetParam(), {{2, 37, 45}, {45, 50}}, [](Graph g, auto in) {
+        return g->addOp<MatmulObj>(in[0], in[1], nullptr)->getOutput();
+    });
+    testAgainstFloat(GetParam(), {{19, 7}, {3, 33, 19}}, [](Graph g, auto in) {
+        return g->addOp<MatmulObj>(in[0], in[1], nullptr, true, true)
+            ->getOutput();
+    });
+}
+
+INSTANTIATE_TEST_SUITE_P(NativeCpu, HalfStorage,
+                         testing::Values(DataType::Float16,
+                                         DataType::BFloat16),
+                         [](const auto &info) {
+                             return info.param.toString();
+                         });
+
+} // namespace infini
@@ -0,0 +1,127 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+// Small integers keep every partial sum exact in float, so the blocked
+// kernel can be compared bit-for-bit with the reference loop.
+static void smallIntGenerator(void *data, size_t size, DataType dtype) {
+    IT_ASSERT(dtype == DataType::Float32);
+    auto ptr = reinterpret_cast<float *>(data);
+    for (size_t i = 0; i < size; ++i)
+        ptr[i] = float(int(i % 7) - 3);
+}
+
+static vector<float> refMatmul(const vector<float> &a, const vector<float> &b,
+                               int batchA, int batchB, int m, int n, int k,
+                               bool transA, bool transB) {
+    int batch = std::max(batchA, batchB);
+    vector<float> c((size_t)batch * m * n, 0);
+    for (int bi = 0; bi < batch; ++bi) {
+        auto pa = a.data() + (batchA == 1 ? 0 : bi) * m * k;
+        auto pb = b.data() + (batchB == 1 ? 0 : bi) * k * n;
+        for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j) {
+                float acc = 0;
+                for (int p = 0; p < k; ++p)
+                    acc += (transA ? pa[p * m + i] : pa[i * k + p]) *
+                           (transB ? pb[j * k + p] : pb[p * n + j]);
+                c[(size_t)bi * m * n + i * n + j] = acc;
+            }
+    }
+    return c;
+}
+
+static void testMatmulNativeCpu(int batchA, int batchB, int m, int n, int k,
+                                bool transA, bool transB) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto A = g->addTensor(transA ? Shape{batchA, k, m} : Shape{batchA, m, k},
+                          DataType::Float32);
+    auto B = g->addTensor(transB ? Shape{batchB, n, k} : Shape{batchB, k, n},
+                          DataType::Float32);
+    auto op = g->addOp<MatmulObj>(A, B, nullptr, transA, transB);
+    g->dataMalloc();
+    A->setData(smallIntGenerator);
+    B->setData(smallIntGenerator);
+
+    runtime->run(g);
+
+    vector<float> a(A->size()), b(B->size());
+    smallIntGenerator(a.data(), a.size(), DataType::Float32);
+    smallIntGenerator(b.data(), b.size(), DataType::Float32);
+    EXPECT_TRUE(op->getOutput()->equalData(
+        refMatmul(a, b, batchA, batchB, m, n, k, transA, transB)));
+}
+
+TEST(Matmul, NativeCpu) {
+    testMatmulNativeCpu(1, 1, 2, 3, 4, false, false);
+    testMatmulNativeCpu(2, 2, 6, 16, 8, false, false);
+    testMatmulNativeCpu(2, 1, 5, 7, 3, true, false);
+    testMatmulNativeCpu(1, 3, 13, 9, 11, false, true);
+    testMatmulNativeCpu(2, 2, 7, 17, 5, true, true);
+    // Crosses the MC, KC and register tile boundaries.
+    testMatmulNativeCpu(1, 1, 101, 37, 300, false, false);
+    testMatmulNativeCpu(1, 1, 101, 37, 300, true, true);
+}
+
+// Runs MatMul(A, B) followed by `build` with and without optimize(), which
+// folds the ops after the MatMul into its epilogue, and compares the two.
+static void testEpilogue(const Shape &a, const Shape &b, const Shape &extra,
+                         const std::function<Tensor(Graph, Tensor, Tensor)> &build,
+                         size_t steps) {
+    auto g = checkOptimize(
+        {a, b, extra},
+        [&](Graph g, TensorVec in) {
+            auto c = g->addOp<MatmulObj>(in[0], in[1], nullptr)->getOutput();
+            return build(g, c, in[2]);
+        },
+        0, smallIntGenerator);
+    ASSERT_EQ(g->getOperators().size(), 1u);
+    auto op = as<MatmulObj>(g->getOperators()[0]);
+    ASSERT_TRUE(op);
+    EXPECT_EQ(op->getEpilogue().size(), steps);
+}
+
+TEST(Matmul, NativeCpuEpilogue) {
+    // bias, Relu and Clip over full and edge tiles and several K blocks
+    testEpilogue({101, 300}, {300, 37}, {37}, [](Graph g, Tensor c, Tensor x) {
+        auto y = g->addOp<AddObj>(c, x, nullptr)->getOutput();
+        y = g->addOp<ReluObj>(y, nullptr)->getOutput();
+        return g->addOp<ClipObj>(y, nullptr, std::nullopt, 40.f)->getOutput();
+    }, 3);
+    // batched residual, with the steps in another order
+    testEpilogue({2, 13, 9}, {9, 20}, {2, 13, 20},
+                 [](Graph g, Tensor c, Tensor x) {
+                     auto y = g->addOp<AddObj>(x, c, nullptr)->getOutput();
+                     y = g->addOp<ClipObj>(y, nullptr, -5.f, 5.f)->getOutput();
+                     return g->addOp<ReluObj>(y, nullptr)->getOutput();
+                 },
+                 3);
+    // an empty K and a bias of rank 2
+    testEpilogue({4, 0}, {0, 5}, {1, 5}, [](Graph g, Tensor c, Tensor x) {
+        return g->addOp<AddObj>(c, x, nullptr)->getOutput();
+    }, 1);
+}
+
+TEST(Matmul, NativeCpuUInt32) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto A = g->addTensor({2, 3}, DataType::UInt32);
+    auto B = g->addTensor({3, 2}, DataType::UInt32);
+    auto op = g->addOp<MatmulObj>(A, B, nullptr);
+    g->dataMalloc();
+    A->setData(IncrementalGenerator());
+    B->setData(IncrementalGenerator());
+
+    runtime->run(g);
+    EXPECT_TRUE(op->getOutput()->equalData(vector<uint32_t>{10, 13, 28, 40}));
+}
+
+} // namespace infini
@@ -4,6 +4,7 @@
 #include "operators/transpose.h"
 
 #include "test.h"
+#include <numeric>
 
 namespace infini {
 
@@ -24,4 +25,65 @@ TEST(Transpose, NativeCpu) {
                                                           8, 9, 10, 11, 20, 21, 22, 23}));
 }
 
+// Reference transpose straight from the definition.
+static vector<float> referenceTranspose(const Shape &dims,
+                                        const vector<int> &perm) {
+    size_t size = std::accumulate(dims.begin(), dims.end(), size_t(1),
+                                  std::multiplies<size_t>());
+    int rank = dims.size();
+    vector<float> out(size);
+    for (size_t inIdx = 0; inIdx < size; ++inIdx) {
+        Shape pos(rank);
+        for (int d = rank - 1, rest = inIdx; d >= 0; --d) {
+            pos[d] = rest % dims[d];
+            rest /= dims[d];
+        }
+        size_t outIdx = 0;
+        for (int j = 0; j < rank; ++j)
+            outIdx = outIdx * dims[perm[j]] + pos[perm[j]];
+        out[outIdx] = inIdx;
+    }
+    return out;
+}
+
+// Covers the flat copy, row copy and tiled paths, with sizes around the
+// 8x8 register blocks and 32x32 tiles, and size-1 dims between merged ones.
+TEST(Transpose, NativeCpuPaths) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    vector<pair<Shape, vector<int>>> cases = {
+        {{2, 3, 4}, {0, 1, 2}},        {{4, 1, 5}, {1, 0, 2}},
+        {{3, 4, 5, 6}, {1, 0, 2, 3}},  {{2, 3, 4, 5}, {2, 3, 0, 1}},
+        {{37, 45}, {1, 0}},            {{3, 64, 40}, {0, 2, 1}},
+        {{2, 9, 5, 17}, {0, 2, 3, 1}}, {{5, 1, 7, 9}, {3, 1, 2, 0}},
+        {{4, 6, 3, 2}, {3, 2, 1, 0}},  {{8, 3, 1, 16}, {3, 0, 2, 1}},
+        {{300, 130}, {1, 0}},
+    };
+    for (auto &[dims, perm] : cases) {
+        Graph g = make_ref<GraphObj>(runtime);
+        auto input = g->addTensor(dims, DataType::Float32);
+        auto op = g->addOp<TransposeObj>(input, nullptr, perm);
+        g->dataMalloc();
+        input->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(
+            op->getOutput()->equalData(referenceTranspose(dims, perm)))
+            << vecToString(dims) << " perm " << vecToString(perm);
+    }
+}
+
+TEST(Transpose, NativeCpuUInt32) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto input = g->addTensor({3, 9}, DataType::UInt32);
+    auto op = g->addOp<TransposeObj>(input, nullptr, vector<int>{1, 0});
+    g->dataMalloc();
+    input->setData(IncrementalGenerator());
+    runtime->run(g);
+    vector<uint32_t> ans;
+    for (uint32_t j = 0; j < 9; ++j)
+        for (uint32_t i = 0; i < 3; ++i)
+            ans.emplace_back(i * 9 + j);
+    EXPECT_TRUE(op->getOutput()->equalData(ans));
+}
+
 } // namespace infini
@@ -0,0 +1,112 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/unary.h"
+#include "utils/simd.h"
+
+#include "test.h"
+
+namespace infini {
+
+// Values -8, -7, ..., spanning both sides of zero.
+static void centeredGenerator(void *data, size_t size, DataType dtype) {
+    IT_ASSERT(dtype == DataType::Float32);
+    auto ptr = reinterpret_cast<float *>(data);
+    for (size_t i = 0; i < size; ++i)
+        ptr[i] = float(i) - 8;
+}
+
+TEST(Relu, NativeCpu) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto input = g->addTensor({3, 7}, DataType::Float32);
+    auto op = g->addOp<ReluObj>(input, nullptr);
+    g->dataMalloc();
+    input->setData(centeredGenerator);
+
+    runtime->run(g);
+    vector<float> ans;
+    for (int i = 0; i < 21; ++i)
+        ans.emplace_back(std::max(0, i - 8));
+    EXPECT_TRUE(op->getOutput()->equalData(ans));
+}
+
+TEST(Clip, NativeCpu) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto input = g->addTensor({3, 7}, DataType::Float32);
+    auto both = g->addOp<ClipObj>(input, nullptr, -2.5f, 4.f);
+    auto lower = g->addOp<ClipObj>(input, nullptr, 1.f, std::nullopt);
+    auto upper = g->addOp<ClipObj>(input, nullptr, std::nullopt, -3.f);
+    g->dataMalloc();
+    input->setData(centeredGenerator);
+
+    runtime->run(g);
+    vector<float> ansBoth, ansLower, ansUpper;
+    for (int i = 0; i < 21; ++i) {
+        float v = i - 8;
+        ansBoth.emplace_back(std::min(4.f, std::max(-2.5f, v)));
+        ansLower.emplace_back(std::max(1.f, v));
+        ansUpper.emplace_back(std::min(-3.f, v));
+    }
+    EXPECT_TRUE(both->getOutput()->equalData(ansBoth));
+    EXPECT_TRUE(lower->getOutput()->equalData(ansLower));
+    EXPECT_TRUE(upper->getOutput()->equalData(ansUpper));
+}
+
+TEST(Clip, NativeCpuUInt32) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto input = g->addTensor({2, 9}, DataType::UInt32);
+    auto op = g->addOp<ClipObj>(input, nullptr, -1.f, 10.f);
+    g->dataMalloc();
+    input->setData(IncrementalGenerator());
+
+    runtime->run(g);
+    EXPECT_TRUE(op->getOutput()->equalData(vector<uint32_t>{
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 10, 10, 10, 10, 10, 10, 10}));
+}
+
+// Every instruction set the CPU supports must agree with the scalar loop,
+// including the tails shorter than a vector.
+TEST(Simd, RowLoopsMatchGeneric) {
+    const size_t n = 37;
+    vector<float> a(n), b(n), out(n), ref(n);
+    vector<uint32_t> ua(n), ub(n), uout(n), uref(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = float(i) - 18.5f;
+        b[i] = float(i % 5) + 0.5f;
+        ua[i] = i * 7 + 3;
+        ub[i] = i % 5 + 1;
+    }
+    for (auto isa : {CpuIsa::Generic, CpuIsa::SSE42, CpuIsa::AVX2,
+                     CpuIsa::AVX512}) {
+        if (isa > getCpuIsa())
+            break;
+        SCOPED_TRACE(cpuIsaToString(isa));
+        for (size_t sb : {0, 1}) {
+            selectBinaryRow<float, DivOp>(isa)(out.data(), a.data(), b.data(),
+                                              n, 1, sb);
+            binaryRowGeneric<float, DivOp>(ref.data(), a.data(), b.data(), n,
+                                           1, sb);
+            EXPECT_EQ(out, ref);
+            selectBinaryRow<uint32_t, MulOp>(isa)(uout.data(), ua.data(),
+                                                  ub.data(), n, 1, sb);
+            binaryRowGeneric<uint32_t, MulOp>(uref.data(), ua.data(),
+                                              ub.data(), n, 1, sb);
+            EXPECT_EQ(uout, uref);
+            selectBinaryRow<uint32_t, SubOp>(isa)(uout.data(), ub.data(),
+                                                  ua.data(), n, sb, 1);
+            binaryRowGeneric<uint32_t, SubOp>(uref.data(), ub.data(),
+                                              ua.data(), n, sb, 1);
+            EXPECT_EQ(uout, uref);
+        }
+        selectClampRow<float>(isa)(out.data(), a.data(), n, -3.f, 7.f);
+        clampRowGeneric<float>(ref.data(), a.data(), n, -3.f, 7.f);
+        EXPECT_EQ(out, ref);
+        selectClampRow<uint32_t>(isa)(uout.data(), ua.data(), n, 10, 100);
+        clampRowGeneric<uint32_t>(uref.data(), ua.data(), n, 10, 100);
+        EXPECT_EQ(uout, uref);
+    }
+}
+
+} // namespace infini